@@ -24,27 +24,48 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++11
 
+# HogKernel / QuantizedKernel 的 SSE4.1 实现，MSVC x64 不需要参数
+!msvc:contains(QT_ARCH, x86_64|i386): QMAKE_CXXFLAGS += -msse4.1
+
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
     ../classifier/PlateCategory_SVM.cpp \
+    ../classifier/PlateCharCascade_SVM.cpp \
+    ../classifier/PlateLayout.cpp \
     ../classifier/PlateChar_SVM.cpp \
     ../classifier/CharSegment_V3.cpp \
     ../classifier/Utilities.cpp \
+    ../classifier/HogExtractor.cpp \
+    ../classifier/MappedFile.cpp \
+    ../classifier/PlateColorMask.cpp \
     ../classifier/PlateLocator_V3.cpp \
     ../classifier/PlateRecognition_V3.cpp \
+    ../classifier/SVMPredictor.cpp \
+    ../classifier/StageTimer.cpp \
+    ../classifier/ThreadPool.cpp \
     manualclassifywindow.cpp
 
 HEADERS += \
         mainwindow.h \
     ../classifier/CharInfo.h \
+    ../classifier/HogExtractor.h \
+    ../classifier/HogKernel.h \
+    ../classifier/MappedFile.h \
+    ../classifier/QuantizedKernel.h \
+    ../classifier/PlateColorMask.h \
     ../classifier/PlateLocator_V3.h \
     ../classifier/PlateCategory_SVM.h \
+    ../classifier/PlateCharCascade_SVM.h \
+    ../classifier/PlateLayout.h \
     ../classifier/csharpImplementations.h \
     ../classifier/CharSegment_V3.h \
     ../classifier/PlateChar_SVM.h \
     ../classifier/Utilities.h \
     ../classifier/PlateRecognition_V3.h \
+    ../classifier/SVMPredictor.h \
+    ../classifier/StageTimer.h \
+    ../classifier/ThreadPool.h \
     manualclassifywindow.h
 
 FORMS += \
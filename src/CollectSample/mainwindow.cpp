@@ -16,8 +16,7 @@ MainWindow::MainWindow(QWidget *parent) :
 
     //this->setWindowState(Qt::WindowState::WindowMaximized);
 
-    PlateCategory_SVM::Load("CategorySVM.yaml");
-    PlateChar_SVM::Load("CharSVM.yaml");
+    recognizer.Load("CategorySVM.yaml", "CharSVM.yaml");
     //设置收集样本界面的icon
     this->setWindowIcon(QIcon("plateUI03.png"));
 }
@@ -255,7 +254,8 @@ void MainWindow::showAllPicturesGotten(QListWidgetItem *item)
 
     Mat matprocess;//图像处理之后的结果
     //auto plates = PlateLocator_V3::LocatePlatesForAutoSample(mat, matprocess);
-    auto plates = PlateLocator_V3::LocatePlatesForAutoSample(mat, matprocess,
+    auto plates = PlateLocator_V3::LocatePlatesForAutoSample(recognizer.CategorySVM,
+                                                             mat, matprocess,
                                                              this->ui->blurSizeBox->value(),
                                                              this->ui->sobelScaleBox->value(),
                                                              this->ui->sobelDeltaBox->value(),
@@ -297,7 +297,7 @@ void MainWindow::showAllPicturesGotten(QListWidgetItem *item)
     for(int index = 0; index < plateInfos.size();index++)
     {
         Mat plateMat = mat(plateInfos[index].OriginalRect);
-        auto chars = CharSegment_V3::SplitePlateForAutoSample(plateMat);
+        auto chars = CharSegment_V3::SplitePlateForAutoSample(recognizer.CharSVM, plateMat);
 
         //比较哪个增强结果好
         vector<CharInfo> charInfosByOriginal = get<0>(chars[0]);
@@ -525,7 +525,7 @@ void MainWindow::on_autoCreateSample_triggered()
         //vector<PlateInfo> plateInfos = PlateLocator_V3::LocatePlates(mat);
 
         //显示车牌
-        vector<PlateInfo> plateInfos = PlateRecognition_V3::Recognite(mat);
+        vector<PlateInfo> plateInfos = recognizer.Recognite(mat);
         showPlateSplit(mat, plateInfos);
         //显示字符
         this->ui->charList->clear();
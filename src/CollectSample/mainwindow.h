@@ -52,6 +52,7 @@ public:
 private:
     Ui::MainWindow *ui;
     QString pathSelected;
+    PlateRecognition_V3 recognizer;
     void showMat(cv::Mat mat,vector<tuple<vector<PlateInfo>, Mat, Mat, vector<vector<Point>>, Mat>> plates);
     QImage Mat2QImage(cv::Mat mat, QImage::Format format);
     QLabel* generateImageLabel(cv::Mat mat,QImage::Format format);
@@ -29,13 +29,24 @@ INCLUDEPATH += D:/Applications/Tools/opencv4.1/opencv/build/include
 INCLUDEPATH += ../classifier/
 CONFIG += c++17
 
+# HogKernel / QuantizedKernel 的 SSE4.1 实现，MSVC x64 不需要参数
+!msvc:contains(QT_ARCH, x86_64|i386): QMAKE_CXXFLAGS += -msse4.1
+
 SOURCES += \
         ../classifier/CharInfo.cpp \
         ../classifier/CharSegment_V3.cpp \
+        ../classifier/HogExtractor.cpp \
+        ../classifier/MappedFile.cpp \
         ../classifier/PlateCategory_SVM.cpp \
+        ../classifier/PlateCharCascade_SVM.cpp \
+        ../classifier/PlateLayout.cpp \
         ../classifier/PlateChar_SVM.cpp \
+        ../classifier/PlateColorMask.cpp \
         ../classifier/PlateLocator_V3.cpp \
         ../classifier/PlateRecognition_V3.cpp \
+        ../classifier/SVMPredictor.cpp \
+        ../classifier/StageTimer.cpp \
+        ../classifier/ThreadPool.cpp \
         ../classifier/Utilities.cpp \
         ../classifier/debug.cpp \
         main.cpp \
@@ -43,9 +54,19 @@ SOURCES += \
 
 HEADERS += \
         ../classifier/CharInfo.h \
+        ../classifier/HogExtractor.h \
+        ../classifier/HogKernel.h \
+        ../classifier/MappedFile.h \
+        ../classifier/QuantizedKernel.h \
         ../classifier/PlateCategory_SVM.h \
+        ../classifier/PlateCharCascade_SVM.h \
+        ../classifier/PlateLayout.h \
         ../classifier/PlateChar_SVM.h \
+        ../classifier/PlateColorMask.h \
         ../classifier/PlateRecognition_V3.h \
+        ../classifier/SVMPredictor.h \
+        ../classifier/StageTimer.h \
+        ../classifier/ThreadPool.h \
         ../classifier/Utilities.h \
         ../classifier/csharpImplementations.h \
         ../classifier/debug.h \
@@ -120,7 +120,7 @@ void MainWindow::recog()
     }
     clock_t start = clock();
     cv::Mat image = cv::imread(this->currentImagePath.toLocal8Bit().toStdString());
-    auto plateInfos = PlateRecognition_V3::Recognite(image);
+    auto plateInfos = recognizer.Recognite(image);
     clock_t end = clock();
     int duration = end - start;
     this->ui->plateWidget->clear();
@@ -361,11 +361,11 @@ void MainWindow::selectPlateModel()
                 this,
                 tr("Open model"),
                 this->plateModelPath.isEmpty()?tr("../classifier"):this->plateModelPath,
-                "*.yaml");
+                "*.yaml *.bin");
     qDebug()<<this->plateModelPath;
     if(this->plateModelPath != "")
     {
-        PlateCategory_SVM::Load(this->plateModelPath.toLocal8Bit().toStdString());
+        recognizer.CategorySVM.Load(this->plateModelPath.toLocal8Bit().toStdString());
     }
 }
 
@@ -375,11 +375,11 @@ void MainWindow::selectCharModel()
                 this,
                 tr("Open model"),
                 this->charModelPath.isEmpty()?tr("../classifier"):this->charModelPath,
-                "*.yaml");
+                "*.yaml *.bin");
     qDebug()<<this->charModelPath;
     if(this->charModelPath != "")
     {
-        PlateChar_SVM::Load(this->charModelPath.toLocal8Bit().toStdString());
+        recognizer.CharSVM.Load(this->charModelPath.toLocal8Bit().toStdString());
     }
 }
 
@@ -11,6 +11,7 @@
 #include "../classifier/CharInfo.h"
 #include "../classifier/PlateCategory_SVM.h"
 #include "../classifier/PlateChar_SVM.h"
+#include "../classifier/PlateRecognition_V3.h"
 
 using namespace Doit::CV::PlateRecogn;
 namespace Ui {
@@ -36,8 +37,7 @@ private:
     QString currentImagePath;
     QString plateModelPath;
     QString charModelPath;
-    PlateCategory_SVM plateClassifier;
-    PlateChar_SVM charClassifier;
+    PlateRecognition_V3 recognizer;
     bool state;
 
 
@@ -6,6 +6,7 @@ using cv::Mat;
 using cv::Rect;
 using RotatedRect_t = cv::RotatedRect;
 
+#include <bitset>
 #include <ios>
 using std::basic_ostream;
 using std::ostringstream;
@@ -200,6 +201,57 @@ constexpr const char *PlateChar_tToString[] = {
     "琼",     "甘", "陕", "贵", "云", "川", "警"};
 EnumOstreamOverload(PlateChar_t);
 
+/**
+ * -----------------------  CharGroup  -----------------------
+ */
+// 级联字符分类第一级的分组，点归到非字符一组
+enum class CharGroup_t { NonChar = 0, Digit, Letter, Hanzi };
+// HACK
+// convert enum to string
+constexpr const char *CharGroup_tToString[] = {"非字符", "数字", "字母",
+                                               "汉字"};
+EnumOstreamOverload(CharGroup_t);
+const int CharGroupCount = 4;
+
+// 每一位对应一个 CharGroup_t，表示字符可能属于哪些组
+typedef unsigned CharGroupMask;
+inline CharGroupMask ToCharGroupMask(CharGroup_t group) {
+    return 1u << static_cast<int>(group);
+}
+
+inline CharGroup_t GetCharGroup(PlateChar_t plateChar) {
+    if (plateChar >= PlateChar_t::A && plateChar <= PlateChar_t::Z)
+        return CharGroup_t::Letter;
+    if (plateChar >= PlateChar_t::_0 && plateChar <= PlateChar_t::_9)
+        return CharGroup_t::Digit;
+    if (plateChar == PlateChar_t::GuangZhou ||
+        (plateChar >= PlateChar_t::BeiJing && plateChar <= PlateChar_t::JingChe))
+        return CharGroup_t::Hanzi;
+    return CharGroup_t::NonChar;
+}
+
+// 每一位对应一个 PlateChar_t，表示字符可能是哪些类别
+const size_t PlateCharCount =
+    sizeof(PlateChar_tToString) / sizeof(PlateChar_tToString[0]);
+typedef std::bitset<PlateCharCount> PlateCharSet;
+
+inline PlateCharSet GetAllPlateChars() { return PlateCharSet().set(); }
+// [first, last] 之间的所有类别
+inline PlateCharSet GetPlateCharSet(PlateChar_t first, PlateChar_t last) {
+    PlateCharSet plateChars;
+    for (int value = (int)first; value <= (int)last; value++)
+        plateChars.set(value);
+    return plateChars;
+}
+inline PlateCharSet GetPlateCharSet(CharGroup_t group) {
+    PlateCharSet plateChars;
+    for (size_t value = 0; value < PlateCharCount; value++) {
+        if (GetCharGroup((PlateChar_t)value) == group)
+            plateChars.set(value);
+    }
+    return plateChars;
+}
+
 /**
  * -----------------------  PlateLocateMethod  -----------------------
  */
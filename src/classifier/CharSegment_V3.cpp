@@ -1,8 +1,13 @@
+#include <algorithm>
 #include <string>
 using std::string;
 #include <utility>
 using std::tuple;
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
 #include "CharInfo.h"
 #include "CharSegment_V3.h"
 #include "PlateChar_SVM.h"
@@ -13,6 +18,85 @@ using cv::Point;
 
 using namespace Doit::CV::PlateRecogn;
 
+namespace {
+// 一行中相邻两个像素不同的次数。向量实现比较 row[i] 和 row[i + 1]，相等的
+// 字节是 -1，减到每个字节的计数里，最多 255 次后用 sad 求和。AVX2 剩下的
+// 部分再用 SSE2 处理，车牌只有一百多列，尾部不能太长
+int CountRowJumps(const uchar *row, int cols) {
+    int pairCount = cols - 1;
+    int equalCount = 0;
+    int col = 0;
+#if defined(__AVX2__)
+    while (col + 32 <= pairCount) {
+        __m256i counts = _mm256_setzero_si256();
+        for (int step = 0; step < 255 && col + 32 <= pairCount;
+             step++, col += 32) {
+            __m256i left = _mm256_loadu_si256((const __m256i *)(row + col));
+            __m256i right =
+                _mm256_loadu_si256((const __m256i *)(row + col + 1));
+            counts = _mm256_sub_epi8(counts, _mm256_cmpeq_epi8(left, right));
+        }
+        __m256i sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+        equalCount += _mm256_extract_epi32(sums, 0) +
+                      _mm256_extract_epi32(sums, 2) +
+                      _mm256_extract_epi32(sums, 4) +
+                      _mm256_extract_epi32(sums, 6);
+    }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    while (col + 16 <= pairCount) {
+        __m128i counts = _mm_setzero_si128();
+        for (int step = 0; step < 255 && col + 16 <= pairCount;
+             step++, col += 16) {
+            __m128i left = _mm_loadu_si128((const __m128i *)(row + col));
+            __m128i right = _mm_loadu_si128((const __m128i *)(row + col + 1));
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(left, right));
+        }
+        __m128i sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+        equalCount += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+    }
+#endif
+    for (; col < pairCount; col++) {
+        equalCount += row[col] == row[col + 1];
+    }
+    return pairCount - equalCount;
+}
+} // namespace
+
+const Mat &SplitTransformCache::GetGray(CharSplitMethod_t splitMethod) {
+    if (splitMethod == CharSplitMethod_t::Unknown)
+        splitMethod = CharSplitMethod_t::Origin;
+    size_t index = static_cast<size_t>(splitMethod);
+    std::call_once(computed[index], [&]() {
+        if (splitMethod == CharSplitMethod_t::Origin) {
+            cv::cvtColor(originalMat, grays[index], cv::COLOR_BGR2GRAY);
+            return;
+        }
+        // Gray 时变换 Origin 的灰度图，变换结果就是要的灰度图
+        bool grayFirst = input == SplitTransformInput_t::Gray;
+        Mat plateMat =
+            grayFirst ? GetGray(CharSplitMethod_t::Origin) : originalMat;
+        switch (splitMethod) {
+        case CharSplitMethod_t::Gamma:
+            plateMat = Utilities::GammaTransform(plateMat, gammaFactor);
+            break;
+        case CharSplitMethod_t::Exponential:
+            plateMat = Utilities::IndexTransform(plateMat);
+            break;
+        case CharSplitMethod_t::Log:
+            plateMat = Utilities::LogTransform(plateMat);
+            break;
+        default:
+            break;
+        }
+        if (grayFirst)
+            grays[index] = plateMat;
+        else
+            cv::cvtColor(plateMat, grays[index], cv::COLOR_BGR2GRAY);
+    });
+    return grays[index];
+}
+
 cv::Mat CharSegment_V3::ClearMaoding(cv::Mat &threshold) {
     vector<float> jumps;
     cv::Mat jump = cv::Mat(threshold.rows, 1, CV_32F).clone();
@@ -87,6 +171,30 @@ cv::Mat CharSegment_V3::ClearBorder(cv::Mat &threshold) {
     return result;
 }
 
+void CharSegment_V3::ClearBorderAndMaoding(cv::Mat &threshold) {
+    CV_Assert(threshold.type() == CV_8UC1);
+    int rows = threshold.rows;
+    int cols = threshold.cols;
+    if (cols == 0)
+        return;
+    // 与 ClearBorder 相同：上下两端相等的相邻像素超过 15% 的是边框
+    int noJumpCountThresh = (int)(0.15f * cols);
+    int minTop = (int)(0.1f * rows);
+    int maxTop = (int)(0.9f * rows);
+    // 与 ClearMaoding 相同：跳变不超过 7 次的行没有字符。被当作边框清掉的行
+    // 没有跳变，在 ClearMaoding 里也会被清掉
+    const int maxMaodingJumps = 7;
+
+    for (int rowIndex = 0; rowIndex < rows; rowIndex++) {
+        uchar *row = threshold.ptr<uchar>(rowIndex);
+        int jumpCount = CountRowJumps(row, cols);
+        bool isBorder = (rowIndex < minTop || rowIndex > maxTop) &&
+                        cols - 1 - jumpCount > noJumpCountThresh;
+        if (isBorder || jumpCount <= maxMaodingJumps)
+            std::fill(row, row + cols, (uchar)0);
+    }
+}
+
 cv::Mat CharSegment_V3::ClearMaodingAndBorder(cv::Mat &gray,
     PlateColor_t &plateColor) {
     cv::Mat threshold;
@@ -109,15 +217,15 @@ cv::Mat CharSegment_V3::ClearMaodingAndBorder(cv::Mat &gray,
         break;
     }
 
-    cv::Mat matOfClearBorder = ClearBorder(threshold);
-    cv::Mat matOfClearMaodingAndBorder = ClearMaoding(matOfClearBorder);
-
-    return matOfClearMaodingAndBorder;
+    // threshold 是新建的，直接在上面清零
+    ClearBorderAndMaoding(threshold);
+    return threshold;
 }
 
-vector<CharInfo> CharSegment_V3::SpliteCharsInPlateMat(cv::Mat &plateMat,
-    vector<Rect> &rects) {
-    if (PlateChar_SVM::IsReady == false) {
+vector<CharInfo>
+CharSegment_V3::SpliteCharsInPlateMat(const PlateChar_SVM &plateCharSVM,
+    cv::Mat &plateMat, vector<Rect> &rects) {
+    if (plateCharSVM.IsReady == false) {
         throw logic_error("The character recognition library is not ready");
     }
 
@@ -130,7 +238,7 @@ vector<CharInfo> CharSegment_V3::SpliteCharsInPlateMat(cv::Mat &plateMat,
         cv::Mat originalMat = plateMat(rect);
         charInfo.OriginalMat = originalMat;
         charInfo.OriginalRect = rect;
-        charInfo.PlateChar = PlateChar_SVM::Test(originalMat);
+        charInfo.PlateChar = plateCharSVM.Test(originalMat);
 
         result.push_back(charInfo);
     }
@@ -142,15 +250,19 @@ vector<CharInfo> CharSegment_V3::SpliteCharsInPlateMat(cv::Mat &plateMat,
 // vector<CharInfo>
 // @return {charinfos, binary image, rected image}
 vector<tuple<vector<CharInfo>, Mat, Mat>>
-CharSegment_V3::SplitePlateForAutoSample(cv::Mat &plateMat) {
+CharSegment_V3::SplitePlateForAutoSample(const PlateChar_SVM &plateCharSVM,
+    cv::Mat &plateMat) {
+    // 蓝色、黄色共用变换后的灰度图
+    SplitTransformCache transforms(plateMat);
 
     // For blue
     std::vector<std::vector<cv::Point>> contours_Original_Blue;
     std::vector<std::vector<cv::Point>> contours_IndexTransform_Blue;
     std::vector<std::vector<cv::Point>> contours_GammaTransform_Blue;
     std::vector<std::vector<cv::Point>> contours_LogTransform_Blue;
-    vector<CharInfo> charInfos_Original_Blue = SplitePlateByOriginal(
-        contours_Original_Blue, plateMat, plateMat, PlateColor_t::BluePlate);
+    vector<CharInfo> charInfos_Original_Blue =
+        SplitePlate(contours_Original_Blue, transforms,
+                    PlateColor_t::BluePlate, CharSplitMethod_t::Origin);
     Mat binaryMat_Original_Blue = plateMat.clone() = 0;
     cv::drawContours(binaryMat_Original_Blue, contours_Original_Blue, -1,
     { 255, 255, 255 }, cv::FILLED);
@@ -159,8 +271,8 @@ CharSegment_V3::SplitePlateForAutoSample(cv::Mat &plateMat) {
     { 0, 0, 255 });
 
     vector<CharInfo> charInfos_IndexTransform_Blue =
-        SplitePlateByIndexTransform(contours_IndexTransform_Blue, plateMat,
-            PlateColor_t::BluePlate);
+        SplitePlate(contours_IndexTransform_Blue, transforms,
+                    PlateColor_t::BluePlate, CharSplitMethod_t::Exponential);
     Mat binaryMat_IndexTransform_Blue = plateMat.clone() = 0;
     cv::drawContours(binaryMat_IndexTransform_Blue,
         contours_IndexTransform_Blue, -1, { 255, 255, 255 }, cv::FILLED);
@@ -169,8 +281,8 @@ CharSegment_V3::SplitePlateForAutoSample(cv::Mat &plateMat) {
     { 0, 0, 255 });
 
     vector<CharInfo> charInfos_GammaTransform_Blue =
-        SplitePlateByGammaTransform(contours_GammaTransform_Blue, plateMat,
-            PlateColor_t::BluePlate);
+        SplitePlate(contours_GammaTransform_Blue, transforms,
+                    PlateColor_t::BluePlate, CharSplitMethod_t::Gamma);
     Mat binaryMat_GammaTransform_Blue = plateMat.clone() = 0;
     cv::drawContours(binaryMat_GammaTransform_Blue,
         contours_GammaTransform_Blue, -1, { 255, 255, 255 }, cv::FILLED);
@@ -178,8 +290,9 @@ CharSegment_V3::SplitePlateForAutoSample(cv::Mat &plateMat) {
     reserveBoundingRects(rectedMat_GammaTransform_Blue, contours_GammaTransform_Blue, -1,
     { 0, 0, 255 });
 
-    vector<CharInfo> charInfos_LogTransform_Blue = SplitePlateByLogTransform(
-        contours_LogTransform_Blue, plateMat, PlateColor_t::BluePlate);
+    vector<CharInfo> charInfos_LogTransform_Blue =
+        SplitePlate(contours_LogTransform_Blue, transforms,
+                    PlateColor_t::BluePlate, CharSplitMethod_t::Log);
     Mat binaryMat_LogTransform_Blue = plateMat.clone() = 0;
     cv::drawContours(binaryMat_LogTransform_Blue, contours_LogTransform_Blue,
         -1, { 255, 255, 255 }, cv::FILLED);
@@ -190,25 +303,25 @@ CharSegment_V3::SplitePlateForAutoSample(cv::Mat &plateMat) {
     int isCharCount_Blue = 0;
 
     for (auto &charInfo : charInfos_Original_Blue) {
-        charInfo.PlateChar = PlateChar_SVM::Test(charInfo.OriginalMat);
+        charInfo.PlateChar = plateCharSVM.Test(charInfo.OriginalMat);
         if (charInfo.PlateChar != PlateChar_t::NonChar) {
             isCharCount_Blue++;
         }
     }
     for (auto &charInfo : charInfos_IndexTransform_Blue) {
-        charInfo.PlateChar = PlateChar_SVM::Test(charInfo.OriginalMat);
+        charInfo.PlateChar = plateCharSVM.Test(charInfo.OriginalMat);
         if (charInfo.PlateChar != PlateChar_t::NonChar) {
             isCharCount_Blue++;
         }
     }
     for (auto &charInfo : charInfos_GammaTransform_Blue) {
-        charInfo.PlateChar = PlateChar_SVM::Test(charInfo.OriginalMat);
+        charInfo.PlateChar = plateCharSVM.Test(charInfo.OriginalMat);
         if (charInfo.PlateChar != PlateChar_t::NonChar) {
             isCharCount_Blue++;
         }
     }
     for (auto &charInfo : charInfos_LogTransform_Blue) {
-        charInfo.PlateChar = PlateChar_SVM::Test(charInfo.OriginalMat);
+        charInfo.PlateChar = plateCharSVM.Test(charInfo.OriginalMat);
         if (charInfo.PlateChar != PlateChar_t::NonChar) {
             isCharCount_Blue++;
         }
@@ -220,8 +333,8 @@ CharSegment_V3::SplitePlateForAutoSample(cv::Mat &plateMat) {
     std::vector<std::vector<cv::Point>> contours_GammaTransform_Yellow;
     std::vector<std::vector<cv::Point>> contours_LogTransform_Yellow;
     vector<CharInfo> charInfos_Original_Yellow =
-        SplitePlateByOriginal(contours_Original_Yellow, plateMat, plateMat,
-            PlateColor_t::YellowPlate);
+        SplitePlate(contours_Original_Yellow, transforms,
+                    PlateColor_t::YellowPlate, CharSplitMethod_t::Origin);
     Mat binaryMat_Original_Yellow = plateMat.clone() = 0;
     cv::drawContours(binaryMat_Original_Yellow, contours_Original_Yellow, -1,
     { 255, 255, 255 }, cv::FILLED);
@@ -230,8 +343,8 @@ CharSegment_V3::SplitePlateForAutoSample(cv::Mat &plateMat) {
     { 0, 0, 255 });
 
     vector<CharInfo> charInfos_IndexTransform_Yellow =
-        SplitePlateByIndexTransform(contours_IndexTransform_Yellow, plateMat,
-            PlateColor_t::YellowPlate);
+        SplitePlate(contours_IndexTransform_Yellow, transforms,
+                    PlateColor_t::YellowPlate, CharSplitMethod_t::Exponential);
     Mat binaryMat_IndexTransform_Yellow = plateMat.clone() = 0;
     cv::drawContours(binaryMat_IndexTransform_Yellow,
         contours_IndexTransform_Yellow, -1, { 255, 255, 255 }, cv::FILLED);
@@ -240,8 +353,8 @@ CharSegment_V3::SplitePlateForAutoSample(cv::Mat &plateMat) {
     { 0, 0, 255 });
 
     vector<CharInfo> charInfos_GammaTransform_Yellow =
-        SplitePlateByGammaTransform(contours_GammaTransform_Yellow, plateMat,
-            PlateColor_t::YellowPlate);
+        SplitePlate(contours_GammaTransform_Yellow, transforms,
+                    PlateColor_t::YellowPlate, CharSplitMethod_t::Gamma);
     Mat binaryMat_GammaTransform_Yellow = plateMat.clone() = 0;
     cv::drawContours(binaryMat_GammaTransform_Yellow,
         contours_GammaTransform_Yellow, -1, { 255, 255, 255 }, cv::FILLED);
@@ -249,8 +362,9 @@ CharSegment_V3::SplitePlateForAutoSample(cv::Mat &plateMat) {
     reserveBoundingRects(rectedMat_GammaTransform_Yellow, contours_GammaTransform_Yellow, -1,
     { 0, 0, 255 });
 
-    vector<CharInfo> charInfos_LogTransform_Yellow = SplitePlateByLogTransform(
-        contours_LogTransform_Yellow, plateMat, PlateColor_t::YellowPlate);
+    vector<CharInfo> charInfos_LogTransform_Yellow =
+        SplitePlate(contours_LogTransform_Yellow, transforms,
+                    PlateColor_t::YellowPlate, CharSplitMethod_t::Log);
     Mat binaryMat_LogTransform_Yellow = plateMat.clone() = 0;
     cv::drawContours(binaryMat_LogTransform_Yellow, contours_LogTransform_Yellow,
         -1, { 255, 255, 255 }, cv::FILLED);
@@ -262,25 +376,25 @@ CharSegment_V3::SplitePlateForAutoSample(cv::Mat &plateMat) {
     int isCharCount_Yellow = 0;
 
     for (auto &charInfo : charInfos_Original_Yellow) {
-        charInfo.PlateChar = PlateChar_SVM::Test(charInfo.OriginalMat);
+        charInfo.PlateChar = plateCharSVM.Test(charInfo.OriginalMat);
         if (charInfo.PlateChar != PlateChar_t::NonChar) {
             isCharCount_Yellow++;
         }
     }
     for (auto &charInfo : charInfos_IndexTransform_Yellow) {
-        charInfo.PlateChar = PlateChar_SVM::Test(charInfo.OriginalMat);
+        charInfo.PlateChar = plateCharSVM.Test(charInfo.OriginalMat);
         if (charInfo.PlateChar != PlateChar_t::NonChar) {
             isCharCount_Yellow++;
         }
     }
     for (auto &charInfo : charInfos_GammaTransform_Yellow) {
-        charInfo.PlateChar = PlateChar_SVM::Test(charInfo.OriginalMat);
+        charInfo.PlateChar = plateCharSVM.Test(charInfo.OriginalMat);
         if (charInfo.PlateChar != PlateChar_t::NonChar) {
             isCharCount_Yellow++;
         }
     }
     for (auto &charInfo : charInfos_LogTransform_Yellow) {
-        charInfo.PlateChar = PlateChar_SVM::Test(charInfo.OriginalMat);
+        charInfo.PlateChar = plateCharSVM.Test(charInfo.OriginalMat);
         if (charInfo.PlateChar != PlateChar_t::NonChar) {
             isCharCount_Yellow++;
         }
@@ -338,25 +452,64 @@ vector<CharInfo> CharSegment_V3::SplitePlateByGammaTransform(
         minHeight, maxHeight, minRatio, maxRatio);
 }
 
+vector<CharInfo> CharSegment_V3::SplitePlate(
+    std::vector<std::vector<cv::Point>> &contours,
+    SplitTransformCache &transforms, PlateColor_t plateColor,
+    CharSplitMethod_t charSplitMethod) {
+    if (charSplitMethod == CharSplitMethod_t::Unknown)
+        charSplitMethod = CharSplitMethod_t::Origin;
+    Mat originalMat = transforms.GetOriginalMat();
+    return SplitePlateByGray(contours, originalMat,
+                             transforms.GetGray(charSplitMethod), plateColor,
+                             charSplitMethod);
+}
+
+vector<CharInfo> CharSegment_V3::SplitePlate(
+    vector<CharCandidate> &candidates, SplitTransformCache &transforms,
+    PlateColor_t plateColor, CharSplitMethod_t charSplitMethod) {
+    if (charSplitMethod == CharSplitMethod_t::Unknown)
+        charSplitMethod = CharSplitMethod_t::Origin;
+    Mat originalMat = transforms.GetOriginalMat();
+    return SplitePlateByGray(candidates, originalMat,
+                             transforms.GetGray(charSplitMethod), plateColor,
+                             charSplitMethod);
+}
+
 vector<CharInfo> CharSegment_V3::SplitePlateByOriginal(
     std::vector<std::vector<cv::Point>> &contours, cv::Mat &originalMat,
     cv::Mat &plateMat, PlateColor_t plateColor,
     CharSplitMethod_t charSplitMethod, int leftLimit, int rightLimit,
     int topLimit, int bottomLimit, int minWidth, int maxWidth, int minHeight,
     int maxHeight, float minRatio, float maxRatio) {
-    vector<CharInfo> result;
-
     cv::Mat gray;
     cv::cvtColor(plateMat, gray, cv::COLOR_BGR2GRAY);
+    return SplitePlateByGray(contours, originalMat, gray, plateColor,
+                             charSplitMethod, leftLimit, rightLimit, topLimit,
+                             bottomLimit, minWidth, maxWidth, minHeight,
+                             maxHeight, minRatio, maxRatio);
+}
 
+namespace {
+// 按颜色反色、去掉边框和铆钉后的二值图。反色生成新的图，不会改动
+// plateGray（可能是缓存中共享的）
+Mat GetCharBinary(const cv::Mat &plateGray, PlateColor_t plateColor) {
+    cv::Mat gray = plateGray;
     if (plateColor == PlateColor_t::WhitePlate ||
         plateColor == PlateColor_t::YellowPlate ||
         plateColor == PlateColor_t::GreenPlate)
         gray = 255 - gray;
     // DebugVisualize("gray", gray);
-    cv::Mat matOfClearMaodingAndBorder =
-        ClearMaodingAndBorder(gray, plateColor);
-    // DebugVisualize("gray", gray);
+    return CharSegment_V3::ClearMaodingAndBorder(gray, plateColor);
+}
+} // namespace
+
+vector<CharInfo> CharSegment_V3::SplitePlateByGray(
+    std::vector<std::vector<cv::Point>> &contours, cv::Mat &originalMat,
+    const cv::Mat &plateGray, PlateColor_t plateColor,
+    CharSplitMethod_t charSplitMethod, int leftLimit, int rightLimit,
+    int topLimit, int bottomLimit, int minWidth, int maxWidth, int minHeight,
+    int maxHeight, float minRatio, float maxRatio) {
+    cv::Mat matOfClearMaodingAndBorder = GetCharBinary(plateGray, plateColor);
     // DEBUG
     // DebugVisualize("matOfClearMaodingAndBorder", matOfClearMaodingAndBorder);
 
@@ -365,7 +518,7 @@ vector<CharInfo> CharSegment_V3::SplitePlateByOriginal(
     cv::findContours(matOfClearMaodingAndBorder, contours, hierarchy,
         cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
 
-    // DEBUG
+#if defined(VISUALIZE_DEBUG) || defined(SAVE_INTERNAL_IMAGE)
     Mat contimage = matOfClearMaodingAndBorder.clone();
     cv::cvtColor(contimage, contimage, cv::COLOR_GRAY2BGR);
     cv::drawContours(contimage, contours, -1, Scalar(0, 0, 255), 1);
@@ -374,11 +527,80 @@ vector<CharInfo> CharSegment_V3::SplitePlateByOriginal(
             CharSplitMethod_tToString[static_cast<size_t>(charSplitMethod)])
         .c_str(),
         contimage);
+#endif
 
-    Mat rectedMat = matOfClearMaodingAndBorder.clone();
-    cv::cvtColor(rectedMat, rectedMat, cv::COLOR_GRAY2BGR);
+    vector<Rect> rects;
     for (auto &contour : contours) {
-        Rect rect = cv::boundingRect(contour);
+        rects.push_back(cv::boundingRect(contour));
+    }
+    return GetCharInfosFromRects(rects, originalMat, matOfClearMaodingAndBorder,
+                                 charSplitMethod, leftLimit, rightLimit,
+                                 topLimit, bottomLimit, minWidth, maxWidth,
+                                 minHeight, maxHeight, minRatio, maxRatio);
+}
+
+vector<CharInfo> CharSegment_V3::SplitePlateByGray(
+    vector<CharCandidate> &candidates, cv::Mat &originalMat,
+    const cv::Mat &plateGray, PlateColor_t plateColor,
+    CharSplitMethod_t charSplitMethod, int leftLimit, int rightLimit,
+    int topLimit, int bottomLimit, int minWidth, int maxWidth, int minHeight,
+    int maxHeight, float minRatio, float maxRatio) {
+    cv::Mat matOfClearMaodingAndBorder = GetCharBinary(plateGray, plateColor);
+    candidates = FindCharCandidates(matOfClearMaodingAndBorder);
+
+    vector<Rect> rects;
+    rects.reserve(candidates.size());
+    for (auto &candidate : candidates) {
+        rects.push_back(candidate.BoundingRect);
+    }
+    return GetCharInfosFromRects(rects, originalMat, matOfClearMaodingAndBorder,
+                                 charSplitMethod, leftLimit, rightLimit,
+                                 topLimit, bottomLimit, minWidth, maxWidth,
+                                 minHeight, maxHeight, minRatio, maxRatio);
+}
+
+vector<CharCandidate> CharSegment_V3::FindCharCandidates(const cv::Mat &binary) {
+    // 从图像外的一圈开始 4 连通地填充背景，填不到的背景是字符中的孔洞。
+    // 孔洞并入包围它的连通域之后，8 连通域与最外层轮廓一一对应，孔洞中的
+    // 连通域（例如“粤”中间的部分）不会单独出现
+    cv::Mat padded;
+    cv::copyMakeBorder(binary, padded, 1, 1, 1, 1, cv::BORDER_CONSTANT,
+                       Scalar(0));
+    cv::floodFill(padded, Point(0, 0), Scalar(128), nullptr, Scalar(0),
+                  Scalar(0), 4);
+    cv::Mat filled = padded != 128;
+
+    cv::Mat labels, stats, centroids;
+    int labelCount = cv::connectedComponentsWithStats(
+        filled(Rect(1, 1, binary.cols, binary.rows)), labels, stats,
+        centroids, 8, CV_32S);
+
+    vector<CharCandidate> candidates;
+    candidates.reserve(std::max(labelCount - 1, 0));
+    // 0 是背景
+    for (int label = 1; label < labelCount; label++) {
+        const int *stat = stats.ptr<int>(label);
+        CharCandidate candidate;
+        candidate.BoundingRect =
+            Rect(stat[cv::CC_STAT_LEFT], stat[cv::CC_STAT_TOP],
+                 stat[cv::CC_STAT_WIDTH], stat[cv::CC_STAT_HEIGHT]);
+        candidate.Area = stat[cv::CC_STAT_AREA];
+        candidates.push_back(candidate);
+    }
+    return candidates;
+}
+
+vector<CharInfo> CharSegment_V3::GetCharInfosFromRects(
+    vector<Rect> &candidateRects, cv::Mat &originalMat, const cv::Mat &binary,
+    CharSplitMethod_t charSplitMethod, int leftLimit, int rightLimit,
+    int topLimit, int bottomLimit, int minWidth, int maxWidth, int minHeight,
+    int maxHeight, float minRatio, float maxRatio) {
+    vector<CharInfo> result;
+
+#if defined(VISUALIZE_DEBUG) || defined(SAVE_INTERNAL_IMAGE)
+    Mat rectedMat = binary.clone();
+    cv::cvtColor(rectedMat, rectedMat, cv::COLOR_GRAY2BGR);
+    for (auto &rect : candidateRects) {
         cv::rectangle(rectedMat, rect, { 0, 0, 255 });
     }
     DebugVisualize(
@@ -386,37 +608,38 @@ vector<CharInfo> CharSegment_V3::SplitePlateByOriginal(
             CharSplitMethod_tToString[static_cast<size_t>(charSplitMethod)])
         .c_str(),
         rectedMat);
+#endif
 
     vector<Rect> rects;
-    for (size_t index = 0; index < contours.size(); index++) {
-        Rect rect = cv::boundingRect(contours[index]);
+    for (size_t index = 0; index < candidateRects.size(); index++) {
+        Rect rect = candidateRects[index];
 
         // DEBUG
-        Mat pos = matOfClearMaodingAndBorder.clone();
-        cv::cvtColor(pos, pos, cv::COLOR_GRAY2BGR);
-        cv::rectangle(pos, rect, { 0, 0, 255 });
+        // Mat pos = binary.clone();
+        // cv::cvtColor(pos, pos, cv::COLOR_GRAY2BGR);
+        // cv::rectangle(pos, rect, { 0, 0, 255 });
         // DebugVisualizeNotWait("rects", pos);
 
-        if (NotOnBorder(rect, cv::Size(plateMat.cols, plateMat.rows), leftLimit,
+        if (NotOnBorder(rect, cv::Size(binary.cols, binary.rows), leftLimit,
             rightLimit, topLimit, bottomLimit) &&
             VerifyRect(rect, minWidth, maxWidth, minHeight, maxHeight, minRatio,
                 maxRatio)) {
             rects.push_back(rect);
-            // DebugVisualize("rects after judgement",
-            // matOfClearMaodingAndBorder(rect));
+            // DebugVisualize("rects after judgement", binary(rect));
         }
     }
 
     rects = RejectInnerRectFromRects(rects);
 
     rects = AdjustRects(rects);
-    // DEBUG
-    Mat rejectedRect = matOfClearMaodingAndBorder.clone();
+#if defined(VISUALIZE_DEBUG) || defined(SAVE_INTERNAL_IMAGE)
+    Mat rejectedRect = binary.clone();
     cv::cvtColor(rejectedRect, rejectedRect, cv::COLOR_GRAY2BGR);
     for (auto &rect : rects) {
         cv::rectangle(rejectedRect, rect, { 0, 0, 255 });
     }
     DebugVisualize("AfterClipBorder ", rejectedRect);
+#endif
     if (rects.size() == 0)
         return result;
     for (size_t index = 0; index < rects.size(); index++) {
@@ -16,6 +16,7 @@ using cv::Rect;
 using cv::Scalar;
 
 #include <cmath>
+#include <mutex>
 #include <string>
 using std::string;
 #include <vector>
@@ -29,6 +30,7 @@ namespace Doit {
 namespace CV {
 namespace PlateRecogn {
 class CharInfo;
+class PlateChar_SVM;
 enum class PlateColor_t;
 enum class CharSplitMethod_t;
 } // namespace PlateRecogn
@@ -39,21 +41,83 @@ namespace Doit {
 namespace CV {
 namespace PlateRecogn {
 
+// 切分方法的增强变换（Gamma、指数、对数）作用在哪种图像上
+enum class SplitTransformInput_t {
+    // 先对 BGR 车牌做变换再转灰度
+    Bgr = 0,
+    // 先转灰度再对单通道做变换，变换的计算量和内存访问约为 Bgr 的 1/3。
+    // 归一化用的是灰度图的最小、最大值，结果与 Bgr 不完全相同
+    Gray
+};
+
+// 二值图中的一个字符候选，对应 findContours(RETR_EXTERNAL) 的一个轮廓
+struct CharCandidate {
+    Rect BoundingRect;
+    // 像素数，包括被它包围的孔洞
+    int Area = 0;
+};
+
+// 从二值图中找字符候选的方法
+enum class CharCandidateExtractor_t {
+    // findContours 之后对每个轮廓求外接矩形
+    Contours = 0,
+    // connectedComponentsWithStats 直接得到外接矩形和面积，不生成轮廓的点
+    ConnectedComponents
+};
+
+/**
+ * 一块车牌各种切分方法用到的灰度图。蓝色、黄色两次切分
+ * 的预处理相同，颜色只决定之后是否反色，同一块车牌用同一个缓存时每种变换
+ * 只算一次。第一次用到时才计算，可以被多个线程同时使用。
+ */
+class SplitTransformCache {
+  public:
+    explicit SplitTransformCache(
+        const Mat &originalMat,
+        SplitTransformInput_t input = SplitTransformInput_t::Bgr,
+        float gammaFactor = 0.40f)
+        : originalMat(originalMat), input(input), gammaFactor(gammaFactor) {}
+
+    SplitTransformCache(const SplitTransformCache &) = delete;
+    SplitTransformCache &operator=(const SplitTransformCache &) = delete;
+
+    const Mat &GetOriginalMat() const { return originalMat; }
+    SplitTransformInput_t GetInput() const { return input; }
+    // Unknown 按 Origin 处理。返回的灰度图是共享的，不能修改
+    const Mat &GetGray(CharSplitMethod_t splitMethod);
+
+  private:
+    static const size_t MethodCount = sizeof(CharSplitMethod_tToString) /
+                                      sizeof(CharSplitMethod_tToString[0]);
+
+    Mat originalMat;
+    SplitTransformInput_t input;
+    float gammaFactor;
+    std::once_flag computed[MethodCount];
+    Mat grays[MethodCount];
+};
+
 class CharSegment_V3 {
   public:
     static cv::Mat ClearMaoding(cv::Mat &threshold);
 
     static cv::Mat ClearBorder(cv::Mat &threshold);
 
+    // 结果与 ClearMaoding(ClearBorder(threshold)) 相同，但直接在 threshold
+    // (CV_8UC1) 上清零，每行的跳变次数只数一遍
+    static void ClearBorderAndMaoding(cv::Mat &threshold);
+
     static cv::Mat ClearMaodingAndBorder(cv::Mat &gray,
                                          PlateColor_t &plateColor);
 
-    static vector<CharInfo> SpliteCharsInPlateMat(cv::Mat &plateMat,
-                                                  vector<Rect> &rects);
+    static vector<CharInfo>
+    SpliteCharsInPlateMat(const PlateChar_SVM &plateCharSVM,
+                          cv::Mat &plateMat, vector<Rect> &rects);
 
     // return {charinfos, binary image, rected image}
     static vector<tuple<vector<CharInfo>, Mat, Mat>>
-    SplitePlateForAutoSample(cv::Mat &plateMat);
+    SplitePlateForAutoSample(const PlateChar_SVM &plateCharSVM,
+                             cv::Mat &plateMat);
 
     static vector<CharInfo> SplitePlateByIndexTransform(
         std::vector<std::vector<cv::Point>> &contours, cv::Mat &originalMat,
@@ -76,6 +140,51 @@ class CharSegment_V3 {
         int minWidth = 2, int maxWidth = 30, int minHeight = 10,
         int maxHeight = 80, float minRatio = 0.08f, float maxRatio = 2.0f);
 
+    // 用 transforms 中缓存的灰度图切分，结果与对应的 SplitePlateByXXX 相同
+    static vector<CharInfo>
+    SplitePlate(std::vector<std::vector<cv::Point>> &contours,
+                SplitTransformCache &transforms, PlateColor_t plateColor,
+                CharSplitMethod_t charSplitMethod);
+
+    // 与上面相同，但用 FindCharCandidates 找字符，candidates 返回过滤之前的
+    // 全部候选
+    static vector<CharInfo>
+    SplitePlate(vector<CharCandidate> &candidates,
+                SplitTransformCache &transforms, PlateColor_t plateColor,
+                CharSplitMethod_t charSplitMethod);
+
+    // gray 是 plateMat 转成的灰度图，按颜色反色、二值化之后找字符
+    static vector<CharInfo> SplitePlateByGray(
+        std::vector<std::vector<cv::Point>> &contours, cv::Mat &originalMat,
+        const cv::Mat &gray, PlateColor_t plateColor,
+        CharSplitMethod_t charSplitMethod = CharSplitMethod_t::Origin,
+        int leftLimit = 0, int rightLimit = 0, int topLimit = 0,
+        int bottomLimit = 0, int minWidth = 2, int maxWidth = 30,
+        int minHeight = 10, int maxHeight = 80, float minRatio = 0.08f,
+        float maxRatio = 2.0);
+
+    static vector<CharInfo> SplitePlateByGray(
+        vector<CharCandidate> &candidates, cv::Mat &originalMat,
+        const cv::Mat &gray, PlateColor_t plateColor,
+        CharSplitMethod_t charSplitMethod = CharSplitMethod_t::Origin,
+        int leftLimit = 0, int rightLimit = 0, int topLimit = 0,
+        int bottomLimit = 0, int minWidth = 2, int maxWidth = 30,
+        int minHeight = 10, int maxHeight = 80, float minRatio = 0.08f,
+        float maxRatio = 2.0);
+
+    // binary 是 0/255 的 CV_8UC1。外接矩形与 findContours(RETR_EXTERNAL)
+    // 各轮廓的外接矩形相同，顺序可能不同
+    static vector<CharCandidate> FindCharCandidates(const cv::Mat &binary);
+
+    // 按位置、大小过滤二值图 binary 中的候选矩形，合并、调整之后从
+    // originalMat 中截出字符
+    static vector<CharInfo> GetCharInfosFromRects(
+        vector<Rect> &candidateRects, cv::Mat &originalMat,
+        const cv::Mat &binary, CharSplitMethod_t charSplitMethod,
+        int leftLimit, int rightLimit, int topLimit, int bottomLimit,
+        int minWidth, int maxWidth, int minHeight, int maxHeight,
+        float minRatio, float maxRatio);
+
     static vector<CharInfo> SplitePlateByOriginal(
         std::vector<std::vector<cv::Point>> &contours, cv::Mat &originalMat,
         cv::Mat &plateMat, PlateColor_t plateColor,
@@ -0,0 +1,268 @@
+#include "HogExtractor.h"
+#include "HogKernel.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace Doit::CV::PlateRecogn;
+
+namespace {
+// 与 OpenCV fastAtan2 相同的多项式近似，返回角度 [0, 360)
+inline float FastAtan2(float y, float x) {
+    const float p1 = 0.9997878412794807f * (float)(180 / CV_PI);
+    const float p3 = -0.3258083974640975f * (float)(180 / CV_PI);
+    const float p5 = 0.1555786518463281f * (float)(180 / CV_PI);
+    const float p7 = -0.04432655554792128f * (float)(180 / CV_PI);
+    float ax = std::abs(x), ay = std::abs(y);
+    float a, c, c2;
+    if (ax >= ay) {
+        c = ay / (ax + (float)DBL_EPSILON);
+        c2 = c * c;
+        a = (((p7 * c2 + p5) * c2 + p3) * c2 + p1) * c;
+    } else {
+        c = ax / (ay + (float)DBL_EPSILON);
+        c2 = c * c;
+        a = 90.f - (((p7 * c2 + p5) * c2 + p3) * c2 + p1) * c;
+    }
+    if (x < 0)
+        a = 180.f - a;
+    if (y < 0)
+        a = 360.f - a;
+    return a;
+}
+
+inline int Reflect101(int index, int size) {
+    return index < 0 ? -index : index >= size ? 2 * size - index - 2 : index;
+}
+} // namespace
+
+HogExtractor::HogExtractor(cv::Size winSize, cv::Size blockSize,
+                           cv::Size blockStride, cv::Size cellSize, int nbins)
+    : winSize(winSize), nbins(nbins) {
+    CV_Assert(blockSize.width % cellSize.width == 0 &&
+              blockSize.height % cellSize.height == 0);
+    CV_Assert((winSize.width - blockSize.width) % blockStride.width == 0 &&
+              (winSize.height - blockSize.height) % blockStride.height == 0);
+    cv::Size cellCount(blockSize.width / cellSize.width,
+                       blockSize.height / cellSize.height);
+    cv::Size blockCount(
+        (winSize.width - blockSize.width) / blockStride.width + 1,
+        (winSize.height - blockSize.height) / blockStride.height + 1);
+    blockHistogramSize = cellCount.area() * nbins;
+    descriptorSize = blockCount.area() * blockHistogramSize;
+
+    // 默认 winSigma 的高斯权重
+    float sigma = (blockSize.width + blockSize.height) / 8.f;
+    float scale = 1.f / (sigma * sigma * 2);
+
+    // cell 的排列是先列后行，与 HOGCache::init 一致
+    vector<BlockPixel> oneCell, twoCells, fourCells;
+    for (int j = 0; j < blockSize.width; j++) {
+        for (int i = 0; i < blockSize.height; i++) {
+            float di = i - blockSize.height * 0.5f;
+            float dj = j - blockSize.width * 0.5f;
+            float gaussian = std::exp(-(di * di + dj * dj) * scale);
+
+            float cellX = (j + 0.5f) / cellSize.width - 0.5f;
+            float cellY = (i + 0.5f) / cellSize.height - 0.5f;
+            int cellX0 = cvFloor(cellX), cellY0 = cvFloor(cellY);
+            int cellX1 = cellX0 + 1, cellY1 = cellY0 + 1;
+            cellX -= cellX0;
+            cellY -= cellY0;
+            bool insideX = (unsigned)cellX0 < (unsigned)cellCount.width &&
+                           (unsigned)cellX1 < (unsigned)cellCount.width;
+            bool insideY = (unsigned)cellY0 < (unsigned)cellCount.height &&
+                           (unsigned)cellY1 < (unsigned)cellCount.height;
+            if (!insideX && (unsigned)cellX0 < (unsigned)cellCount.width) {
+                cellX1 = cellX0;
+                cellX = 1.f - cellX;
+            }
+            if (!insideY && (unsigned)cellY0 < (unsigned)cellCount.height) {
+                cellY1 = cellY0;
+                cellY = 1.f - cellY;
+            }
+
+            BlockPixel pixel = {};
+            pixel.Offset = i * winSize.width + j;
+            auto add = [&](int x, int y, float weight) {
+                pixel.HistogramOffset[pixel.CellCount] =
+                    (x * cellCount.height + y) * nbins;
+                pixel.Weight[pixel.CellCount] = gaussian * weight;
+                pixel.CellCount++;
+            };
+            if (insideX && insideY) {
+                add(cellX0, cellY0, (1.f - cellX) * (1.f - cellY));
+                add(cellX1, cellY0, cellX * (1.f - cellY));
+                add(cellX0, cellY1, (1.f - cellX) * cellY);
+                add(cellX1, cellY1, cellX * cellY);
+                fourCells.push_back(pixel);
+            } else if (insideX) {
+                add(cellX0, cellY1, (1.f - cellX) * cellY);
+                add(cellX1, cellY1, cellX * cellY);
+                twoCells.push_back(pixel);
+            } else if (insideY) {
+                add(cellX1, cellY0, cellX * (1.f - cellY));
+                add(cellX1, cellY1, cellX * cellY);
+                twoCells.push_back(pixel);
+            } else {
+                add(cellX1, cellY1, cellX * cellY);
+                oneCell.push_back(pixel);
+            }
+        }
+    }
+    blockPixels = oneCell;
+    blockPixels.insert(blockPixels.end(), twoCells.begin(), twoCells.end());
+    blockPixels.insert(blockPixels.end(), fourCells.begin(), fourCells.end());
+
+    for (int j = 0; j < blockCount.width; j++) {
+        for (int i = 0; i < blockCount.height; i++) {
+            blockOffsets.push_back(i * blockStride.height * winSize.width +
+                                   j * blockStride.width);
+        }
+    }
+
+    for (int x = -1; x <= winSize.width; x++) {
+        xmap.push_back(Reflect101(x, winSize.width));
+    }
+    magnitudeLow.resize(winSize.area());
+    magnitudeHigh.resize(winSize.area());
+    binLow.resize(winSize.area());
+    binHigh.resize(winSize.area());
+    scratch.resize(winSize.width * 4);
+
+    bool standardBlock = blockSize == cv::Size(16, 16) &&
+                         blockStride == cv::Size(8, 8) &&
+                         cellSize == cv::Size(8, 8) && nbins == 9;
+    if (standardBlock && winSize == cv::Size(16, 32)) {
+        gradientKernel = HogKernel<16, 32>::ComputeGradient;
+        normalizeKernel = HogKernel<16, 32>::NormalizeBlock;
+        scratch.resize(HogKernel<16, 32>::ScratchSize);
+    } else if (standardBlock && winSize == cv::Size(96, 32)) {
+        gradientKernel = HogKernel<96, 32>::ComputeGradient;
+        normalizeKernel = HogKernel<96, 32>::NormalizeBlock;
+        scratch.resize(HogKernel<96, 32>::ScratchSize);
+    }
+}
+
+void HogExtractor::Compute(const Mat &image, float *descriptor) {
+    CV_Assert(image.type() == CV_8UC1 || image.type() == CV_8UC3);
+    cv::resize(image, resized, winSize);
+    if (gradientKernel != nullptr)
+        gradientKernel(resized, scratch.data(), magnitudeLow.data(),
+                       magnitudeHigh.data(), binLow.data(), binHigh.data());
+    else
+        ComputeGradient();
+    for (size_t index = 0; index < blockOffsets.size(); index++) {
+        float *histogram = descriptor + index * blockHistogramSize;
+        ComputeBlock(blockOffsets[index], histogram);
+        if (normalizeKernel != nullptr)
+            normalizeKernel(histogram);
+        else
+            NormalizeBlock(histogram);
+    }
+}
+
+void HogExtractor::Compute(const Mat &image, vector<float> &descriptor) {
+    descriptor.resize(descriptorSize);
+    Compute(image, descriptor.data());
+}
+
+void HogExtractor::ComputeGradient() {
+    int width = winSize.width, height = winSize.height;
+    int channels = resized.channels();
+    float angleScale = (float)(nbins / CV_PI);
+    float *dxs = scratch.data(), *dys = dxs + width;
+    float *magnitudes = dys + width, *angles = magnitudes + width;
+
+    for (int y = 0; y < height; y++) {
+        const uchar *current = resized.ptr<uchar>(y);
+        const uchar *previous = resized.ptr<uchar>(Reflect101(y - 1, height));
+        const uchar *next = resized.ptr<uchar>(Reflect101(y + 1, height));
+        if (channels == 1) {
+            for (int x = 0; x < width; x++) {
+                int x1 = xmap[x + 1];
+                dxs[x] = (float)(current[xmap[x + 2]] - current[xmap[x]]);
+                dys[x] = (float)(next[x1] - previous[x1]);
+            }
+        } else {
+            // 三个通道中取幅值最大的梯度，相同时依次优先 R、G、B
+            for (int x = 0; x < width; x++) {
+                int x1 = xmap[x + 1] * 3;
+                const uchar *right = current + xmap[x + 2] * 3;
+                const uchar *left = current + xmap[x] * 3;
+                float dx0 = (float)(right[2] - left[2]);
+                float dy0 = (float)(next[x1 + 2] - previous[x1 + 2]);
+                float magnitude0 = dx0 * dx0 + dy0 * dy0;
+                for (int c = 1; c >= 0; c--) {
+                    float dx = (float)(right[c] - left[c]);
+                    float dy = (float)(next[x1 + c] - previous[x1 + c]);
+                    float magnitude = dx * dx + dy * dy;
+                    if (magnitude0 < magnitude) {
+                        dx0 = dx;
+                        dy0 = dy;
+                        magnitude0 = magnitude;
+                    }
+                }
+                dxs[x] = dx0;
+                dys[x] = dy0;
+            }
+        }
+
+        for (int x = 0; x < width; x++) {
+            magnitudes[x] = std::sqrt(dxs[x] * dxs[x] + dys[x] * dys[x]);
+            angles[x] = FastAtan2(dys[x], dxs[x]) * (float)(CV_PI / 180);
+        }
+
+        int offset = y * width;
+        for (int x = 0; x < width; x++) {
+            float angle = angles[x] * angleScale - 0.5f;
+            int bin = cvFloor(angle);
+            angle -= bin;
+            magnitudeLow[offset + x] = magnitudes[x] * (1.f - angle);
+            magnitudeHigh[offset + x] = magnitudes[x] * angle;
+            if (bin < 0)
+                bin += nbins;
+            else if (bin >= nbins)
+                bin -= nbins;
+            binLow[offset + x] = bin;
+            bin++;
+            binHigh[offset + x] = bin < nbins ? bin : 0;
+        }
+    }
+}
+
+void HogExtractor::ComputeBlock(int blockOffset, float *histogram) const {
+    std::fill(histogram, histogram + blockHistogramSize, 0.f);
+    for (const BlockPixel &pixel : blockPixels) {
+        int offset = blockOffset + pixel.Offset;
+        float low = magnitudeLow[offset], high = magnitudeHigh[offset];
+        int lowBin = binLow[offset], highBin = binHigh[offset];
+        for (int k = 0; k < pixel.CellCount; k++) {
+            float *cell = histogram + pixel.HistogramOffset[k];
+            cell[lowBin] += low * pixel.Weight[k];
+            cell[highBin] += high * pixel.Weight[k];
+        }
+    }
+}
+
+void HogExtractor::NormalizeBlock(float *histogram) const {
+    // L2Hys：归一化后截断到 0.2 再归一化一次
+    const float threshold = 0.2f;
+    float sum = 0;
+    for (int i = 0; i < blockHistogramSize; i++) {
+        sum += histogram[i] * histogram[i];
+    }
+    float scale = 1.f / (std::sqrt(sum) + blockHistogramSize * 0.1f);
+    sum = 0;
+    for (int i = 0; i < blockHistogramSize; i++) {
+        histogram[i] = std::min(histogram[i] * scale, threshold);
+        sum += histogram[i] * histogram[i];
+    }
+    scale = 1.f / (std::sqrt(sum) + 1e-3f);
+    for (int i = 0; i < blockHistogramSize; i++) {
+        histogram[i] *= scale;
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef HOG_EXTRACTOR_H
+#define HOG_EXTRACTOR_H
+
+#include <opencv2/core.hpp>
+using cv::Mat;
+
+#include <vector>
+using std::vector;
+
+namespace Doit {
+namespace CV {
+namespace PlateRecogn {
+
+/**
+ * 单窗口的 HOG 特征，与 HOGDescriptor(winSize, blockSize, blockStride,
+ * cellSize, nbins).compute(resized, descriptors, Size(1, 1), Size(0, 0))
+ * 的计算方式相同：默认的 winSigma、L2Hys、无 gamma 校正、无符号梯度。
+ *
+ * 块内每个像素落到哪些 cell、权重是多少，以及每个块在窗口中的位置，都在
+ * 构造时算好。缩放后的图像和梯度缓冲区由实例持有并反复使用，结果直接写到
+ * 调用者提供的数组里，稳定后每次计算不再分配内存。
+ *
+ * 字符 (16x32) 和车牌 (96x32) 窗口使用标准块参数时，梯度和块归一化交给按
+ * 窗口尺寸特化的向量化 HogKernel，其他参数使用通用的标量实现。
+ *
+ * 实例带有缓冲区，不能被多个线程同时使用。
+ */
+class HogExtractor {
+  public:
+    HogExtractor(cv::Size winSize, cv::Size blockSize, cv::Size blockStride,
+                 cv::Size cellSize, int nbins);
+
+    cv::Size GetWinSize() const { return winSize; }
+    int GetDescriptorSize() const { return descriptorSize; }
+
+    // image 是 CV_8UC1 或 CV_8UC3，先缩放到 winSize；
+    // descriptor 至少有 GetDescriptorSize() 个 float
+    void Compute(const Mat &image, float *descriptor);
+    void Compute(const Mat &image, vector<float> &descriptor);
+
+  private:
+    // 按 OpenCV computeGradient 计算 resized 每个像素的两个相邻方向格子
+    // 及分到这两个格子的梯度幅值
+    void ComputeGradient();
+    void ComputeBlock(int blockOffset, float *histogram) const;
+    void NormalizeBlock(float *histogram) const;
+
+    typedef void (*GradientKernel)(const Mat &image, float *scratch,
+                                   float *magnitudeLow, float *magnitudeHigh,
+                                   int *binLow, int *binHigh);
+    typedef void (*NormalizeKernel)(float *histogram);
+    // 窗口和块参数与某个 HogKernel 一致时不为空
+    GradientKernel gradientKernel = nullptr;
+    NormalizeKernel normalizeKernel = nullptr;
+
+    // 块内的一个像素，最多落到 4 个 cell 上，Weight 已经乘上高斯权重
+    struct BlockPixel {
+        int Offset;
+        int CellCount;
+        int HistogramOffset[4];
+        float Weight[4];
+    };
+
+    cv::Size winSize;
+    int nbins;
+    int blockHistogramSize;
+    int descriptorSize;
+    // 与 OpenCV 一样按落到 1、2、4 个 cell 的顺序排列
+    vector<BlockPixel> blockPixels;
+    // 每个块左上角在窗口中的像素下标，先列后行
+    vector<int> blockOffsets;
+    // BORDER_REFLECT_101 的左右邻居列，xmap[x + 1] 对应 x，x 取 -1 .. width
+    vector<int> xmap;
+
+    Mat resized;
+    // 按行排列，每个像素分到两个相邻方向格子的幅值和格子下标
+    vector<float> magnitudeLow;
+    vector<float> magnitudeHigh;
+    vector<int> binLow;
+    vector<int> binHigh;
+    // 通用实现中一行的 dx、dy、幅值、角度，或 HogKernel 的补边平面
+    vector<float> scratch;
+};
+
+} // namespace PlateRecogn
+} // namespace CV
+} // namespace Doit
+
+#endif // !HOG_EXTRACTOR_H
@@ -0,0 +1,277 @@
+#ifndef HOG_KERNEL_H
+#define HOG_KERNEL_H
+
+#include <opencv2/core.hpp>
+using cv::Mat;
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__) || (defined(_MSC_VER) && defined(__AVX__))
+#include <smmintrin.h>
+#endif
+
+namespace Doit {
+namespace CV {
+namespace PlateRecogn {
+
+// HogKernel 用到的向量运算。编译时打开 AVX2 (-mavx2) 或 SSE4.1 (-msse4.1，
+// 默认打开；MSVC 不定义 __SSE4_1__，要 /arch:AVX 以上才使用) 时一次处理
+// 8 / 4 个 float，否则退化为逐个 float 的标量实现
+namespace HogSimd {
+#if defined(__AVX2__)
+const int Width = 8;
+typedef __m256 Float;
+typedef __m256 Mask;
+inline Float Load(const float *p) { return _mm256_loadu_ps(p); }
+inline void Store(float *p, Float v) { _mm256_storeu_ps(p, v); }
+inline void StoreInt(int *p, Float v) {
+    _mm256_storeu_si256((__m256i *)p, _mm256_cvttps_epi32(v));
+}
+inline Float Set(float v) { return _mm256_set1_ps(v); }
+inline Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+inline Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+inline Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+inline Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+inline Float Sqrt(Float a) { return _mm256_sqrt_ps(a); }
+inline Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+inline Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+inline Float Abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+inline Float Floor(Float a) { return _mm256_floor_ps(a); }
+inline Mask Less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline Mask GreaterEqual(Float a, Float b) {
+    return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+}
+inline Float Select(Mask mask, Float a, Float b) {
+    return _mm256_blendv_ps(b, a, mask);
+}
+inline float Sum(Float v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v),
+                            _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+#elif defined(__SSE4_1__) || (defined(_MSC_VER) && defined(__AVX__))
+const int Width = 4;
+typedef __m128 Float;
+typedef __m128 Mask;
+inline Float Load(const float *p) { return _mm_loadu_ps(p); }
+inline void Store(float *p, Float v) { _mm_storeu_ps(p, v); }
+inline void StoreInt(int *p, Float v) {
+    _mm_storeu_si128((__m128i *)p, _mm_cvttps_epi32(v));
+}
+inline Float Set(float v) { return _mm_set1_ps(v); }
+inline Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+inline Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+inline Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+inline Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+inline Float Sqrt(Float a) { return _mm_sqrt_ps(a); }
+inline Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+inline Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+inline Float Abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+inline Float Floor(Float a) { return _mm_floor_ps(a); }
+inline Mask Less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+inline Mask GreaterEqual(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+inline Float Select(Mask mask, Float a, Float b) {
+    return _mm_blendv_ps(b, a, mask);
+}
+inline float Sum(Float v) {
+    __m128 sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+#else
+const int Width = 1;
+typedef float Float;
+typedef bool Mask;
+inline Float Load(const float *p) { return *p; }
+inline void Store(float *p, Float v) { *p = v; }
+inline void StoreInt(int *p, Float v) { *p = (int)v; }
+inline Float Set(float v) { return v; }
+inline Float Add(Float a, Float b) { return a + b; }
+inline Float Sub(Float a, Float b) { return a - b; }
+inline Float Mul(Float a, Float b) { return a * b; }
+inline Float Div(Float a, Float b) { return a / b; }
+inline Float Sqrt(Float a) { return std::sqrt(a); }
+inline Float Min(Float a, Float b) { return std::min(a, b); }
+inline Float Max(Float a, Float b) { return std::max(a, b); }
+inline Float Abs(Float a) { return std::abs(a); }
+inline Float Floor(Float a) { return std::floor(a); }
+inline Mask Less(Float a, Float b) { return a < b; }
+inline Mask GreaterEqual(Float a, Float b) { return a >= b; }
+inline Float Select(Mask mask, Float a, Float b) { return mask ? a : b; }
+inline float Sum(Float v) { return v; }
+#endif
+
+// 与 OpenCV fastAtan2 相同的多项式，返回角度 [0, 360]
+inline Float FastAtan2(Float y, Float x) {
+    const Float p1 = Set(0.9997878412794807f * (float)(180 / CV_PI));
+    const Float p3 = Set(-0.3258083974640975f * (float)(180 / CV_PI));
+    const Float p5 = Set(0.1555786518463281f * (float)(180 / CV_PI));
+    const Float p7 = Set(-0.04432655554792128f * (float)(180 / CV_PI));
+    const Float zero = Set(0.f);
+    Float ax = Abs(x), ay = Abs(y);
+    Float c = Div(Min(ax, ay), Add(Max(ax, ay), Set((float)DBL_EPSILON)));
+    Float c2 = Mul(c, c);
+    Float a = Mul(Add(Mul(Add(Mul(Add(Mul(p7, c2), p5), c2), p3), c2), p1), c);
+    a = Select(GreaterEqual(ax, ay), a, Sub(Set(90.f), a));
+    a = Select(Less(x, zero), Sub(Set(180.f), a), a);
+    a = Select(Less(y, zero), Sub(Set(360.f), a), a);
+    return a;
+}
+} // namespace HogSimd
+
+/**
+ * 固定窗口的 HOG 梯度和块归一化：16x16 块、8x8 步长和 cell、9 个方向，
+ * 窗口 WinWidth x WinHeight 在编译时确定（字符 16x32、车牌 96x32）。
+ *
+ * 图像先展开成带一圈 BORDER_REFLECT_101 边框的 float 平面，之后每一行的
+ * 差分、多通道取最大、幅值、fastAtan2 和方向格子划分都按向量计算。
+ * 逐像素的运算顺序与 HogExtractor 的通用实现相同，结果只在块归一化求和的
+ * 顺序上有差别；与 HOGDescriptor::compute 相比每一维的误差在 1e-4 以内。
+ */
+template <int WinWidth, int WinHeight> class HogKernel {
+  public:
+    static const int NBins = 9;
+    static const int BlockHistogramSize = 4 * NBins;
+    static const int PaddedWidth = WinWidth + 2;
+    static const int PaddedHeight = WinHeight + 2;
+    // ComputeGradient 需要的 scratch 大小（float 个数）
+    static const int ScratchSize = PaddedWidth * PaddedHeight * 3;
+
+    static_assert(WinWidth % HogSimd::Width == 0,
+                  "window width must be a multiple of the vector width");
+    static_assert(WinWidth >= 16 && WinHeight >= 16 && WinWidth % 8 == 0 &&
+                      WinHeight % 8 == 0,
+                  "window must be covered by 16x16 blocks at 8x8 stride");
+
+    // image 为 WinWidth x WinHeight 的 CV_8UC1 或 CV_8UC3，输出按行排列：
+    // 每个像素分到相邻两个方向格子的幅值和格子下标
+    static void ComputeGradient(const Mat &image, float *scratch,
+                                float *magnitudeLow, float *magnitudeHigh,
+                                int *binLow, int *binHigh) {
+        using namespace HogSimd;
+        CV_Assert(image.rows == WinHeight && image.cols == WinWidth);
+        int channels = image.channels();
+        LoadPlanes(image, scratch);
+
+        const float *planes[3] = {scratch, scratch + PaddedWidth * PaddedHeight,
+                                  scratch + PaddedWidth * PaddedHeight * 2};
+        const Float zero = Set(0.f);
+        const Float bins = Set((float)NBins);
+        const Float toRadian = Set((float)(CV_PI / 180));
+        const Float angleScale = Set((float)(NBins / CV_PI));
+        for (int y = 0; y < WinHeight; y++) {
+            for (int x = 0; x < WinWidth; x += Width) {
+                // 取幅值最大的通道，相同时依次优先 R、G、B
+                int c = channels == 1 ? 0 : 2;
+                Float dx0, dy0, magnitude0;
+                Difference(planes[c], x, y, dx0, dy0);
+                magnitude0 = Add(Mul(dx0, dx0), Mul(dy0, dy0));
+                for (c = c - 1; c >= 0; c--) {
+                    Float dx, dy;
+                    Difference(planes[c], x, y, dx, dy);
+                    Float magnitude = Add(Mul(dx, dx), Mul(dy, dy));
+                    Mask larger = Less(magnitude0, magnitude);
+                    dx0 = Select(larger, dx, dx0);
+                    dy0 = Select(larger, dy, dy0);
+                    magnitude0 = Select(larger, magnitude, magnitude0);
+                }
+
+                Float magnitude = Sqrt(Add(Mul(dx0, dx0), Mul(dy0, dy0)));
+                Float angle = Mul(FastAtan2(dy0, dx0), toRadian);
+                angle = Sub(Mul(angle, angleScale), Set(0.5f));
+                Float bin = Floor(angle);
+                angle = Sub(angle, bin);
+                bin = Add(bin, Select(Less(bin, zero), bins, zero));
+                bin = Sub(bin, Select(GreaterEqual(bin, bins), bins, zero));
+                Float nextBin = Add(bin, Set(1.f));
+                nextBin = Select(GreaterEqual(nextBin, bins), zero, nextBin);
+
+                int offset = y * WinWidth + x;
+                Store(magnitudeLow + offset,
+                      Mul(magnitude, Sub(Set(1.f), angle)));
+                Store(magnitudeHigh + offset, Mul(magnitude, angle));
+                StoreInt(binLow + offset, bin);
+                StoreInt(binHigh + offset, nextBin);
+            }
+        }
+    }
+
+    // L2Hys：归一化后截断到 0.2 再归一化一次
+    static void NormalizeBlock(float *histogram) {
+        using namespace HogSimd;
+        const int vectorEnd = BlockHistogramSize / Width * Width;
+        Float sums = Set(0.f);
+        int i = 0;
+        for (; i < vectorEnd; i += Width) {
+            Float value = Load(histogram + i);
+            sums = Add(sums, Mul(value, value));
+        }
+        float sum = Sum(sums);
+        for (; i < BlockHistogramSize; i++) {
+            sum += histogram[i] * histogram[i];
+        }
+
+        float scale = 1.f / (std::sqrt(sum) + BlockHistogramSize * 0.1f);
+        const Float threshold = Set(0.2f);
+        sums = Set(0.f);
+        for (i = 0; i < vectorEnd; i += Width) {
+            Float value = Min(Mul(Load(histogram + i), Set(scale)), threshold);
+            Store(histogram + i, value);
+            sums = Add(sums, Mul(value, value));
+        }
+        sum = Sum(sums);
+        for (; i < BlockHistogramSize; i++) {
+            histogram[i] = std::min(histogram[i] * scale, 0.2f);
+            sum += histogram[i] * histogram[i];
+        }
+
+        scale = 1.f / (std::sqrt(sum) + 1e-3f);
+        for (i = 0; i < vectorEnd; i += Width) {
+            Store(histogram + i, Mul(Load(histogram + i), Set(scale)));
+        }
+        for (; i < BlockHistogramSize; i++) {
+            histogram[i] *= scale;
+        }
+    }
+
+  private:
+    // 每个通道一块 PaddedWidth x PaddedHeight 的 float 平面，四周按
+    // BORDER_REFLECT_101 补一圈
+    static void LoadPlanes(const Mat &image, float *scratch) {
+        int channels = image.channels();
+        for (int y = -1; y <= WinHeight; y++) {
+            int sourceY = y < 0 ? 1 : y == WinHeight ? WinHeight - 2 : y;
+            const uchar *source = image.ptr<uchar>(sourceY);
+            int rowOffset = (y + 1) * PaddedWidth + 1;
+            for (int c = 0; c < channels; c++) {
+                float *plane = scratch + PaddedWidth * PaddedHeight * c;
+                float *row = plane + rowOffset;
+                for (int x = 0; x < WinWidth; x++) {
+                    row[x] = source[x * channels + c];
+                }
+                row[-1] = row[1];
+                row[WinWidth] = row[WinWidth - 2];
+            }
+        }
+    }
+
+    static void Difference(const float *plane, int x, int y,
+                           HogSimd::Float &dx, HogSimd::Float &dy) {
+        using namespace HogSimd;
+        const float *row = plane + (y + 1) * PaddedWidth + x + 1;
+        dx = Sub(Load(row + 1), Load(row - 1));
+        dy = Sub(Load(row + PaddedWidth), Load(row - PaddedWidth));
+    }
+};
+
+} // namespace PlateRecogn
+} // namespace CV
+} // namespace Doit
+
+#endif // !HOG_KERNEL_H
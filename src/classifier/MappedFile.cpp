@@ -0,0 +1,69 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+using std::logic_error;
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Doit::CV::PlateRecogn;
+
+#ifdef _WIN32
+MappedFile::MappedFile(const string &fileName) {
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        throw logic_error("cannot open " + fileName);
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        throw logic_error("cannot map empty file " + fileName);
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        throw logic_error("cannot map " + fileName);
+    // 视图会保持映射对象，句柄可以先关掉
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == NULL)
+        throw logic_error("cannot map " + fileName);
+    data = (const unsigned char *)view;
+    size = (size_t)fileSize.QuadPart;
+}
+
+MappedFile::~MappedFile() {
+    if (data != nullptr)
+        UnmapViewOfFile(data);
+}
+#else
+MappedFile::MappedFile(const string &fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw logic_error("cannot open " + fileName);
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+        close(fd);
+        throw logic_error("cannot map empty file " + fileName);
+    }
+    // 映射建立后文件描述符可以先关掉
+    void *view = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+        throw logic_error("cannot map " + fileName);
+    data = (const unsigned char *)view;
+    size = (size_t)status.st_size;
+}
+
+MappedFile::~MappedFile() {
+    if (data != nullptr)
+        munmap((void *)data, size);
+}
+#endif
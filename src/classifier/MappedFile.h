@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+using std::string;
+
+namespace Doit {
+namespace CV {
+namespace PlateRecogn {
+
+/**
+ * 只读内存映射的整个文件。多个进程映射同一个文件时共享物理页。
+ * 打开或映射失败时抛出 logic_error。
+ */
+class MappedFile {
+  public:
+    explicit MappedFile(const string &fileName);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const unsigned char *Data() const { return data; }
+    size_t Size() const { return size; }
+
+  private:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+};
+
+} // namespace PlateRecogn
+} // namespace CV
+} // namespace Doit
+
+#endif // !MAPPED_FILE_H
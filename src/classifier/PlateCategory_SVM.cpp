@@ -4,14 +4,11 @@
 
 using namespace Doit::CV::PlateRecogn;
 
-bool PlateCategory_SVM::IsReady = false;
-cv::Size PlateCategory_SVM::HOGWinSize = cv::Size(96, 32);
-cv::Size PlateCategory_SVM::HOGBlockSize = cv::Size(16, 16);
-cv::Size PlateCategory_SVM::HOGBlockStride = cv::Size(8, 8);
-cv::Size PlateCategory_SVM::HOGCellSize = cv::Size(8, 8);
-int PlateCategory_SVM::HOGNBits = 9;
-Ptr<SVM> PlateCategory_SVM::svm = null;
-Random PlateCategory_SVM::random = Random();
+const cv::Size PlateCategory_SVM::HOGWinSize = cv::Size(96, 32);
+const cv::Size PlateCategory_SVM::HOGBlockSize = cv::Size(16, 16);
+const cv::Size PlateCategory_SVM::HOGBlockStride = cv::Size(8, 8);
+const cv::Size PlateCategory_SVM::HOGCellSize = cv::Size(8, 8);
+const int PlateCategory_SVM::HOGNBits = 9;
 
 void PlateCategory_SVM::SavePlateSample(PlateInfo &plateInfo, string fileName) {
     cv::imwrite(fileName, plateInfo.OriginalMat);
@@ -51,15 +48,37 @@ void PlateCategory_SVM::SavePlateSample(Mat &matPlate,
 }
 
 // use vector to replace array
-vector<float> PlateCategory_SVM::ComputeHogDescriptors(Mat &image) {
-    Mat matToHog;
-    cv::resize(image, matToHog, HOGWinSize);
-    HOGDescriptor hog = HOGDescriptor(HOGWinSize, HOGBlockSize, HOGBlockStride,
-                                      HOGCellSize, HOGNBits);
+namespace {
+HogExtractor &GetHogExtractor() {
+    thread_local HogExtractor extractor(
+        PlateCategory_SVM::HOGWinSize, PlateCategory_SVM::HOGBlockSize,
+        PlateCategory_SVM::HOGBlockStride, PlateCategory_SVM::HOGCellSize,
+        PlateCategory_SVM::HOGNBits);
+    return extractor;
+}
+HogParameters GetHogParameters() {
+    HogParameters hog;
+    hog.WinSize = PlateCategory_SVM::HOGWinSize;
+    hog.BlockSize = PlateCategory_SVM::HOGBlockSize;
+    hog.BlockStride = PlateCategory_SVM::HOGBlockStride;
+    hog.CellSize = PlateCategory_SVM::HOGCellSize;
+    hog.NBins = PlateCategory_SVM::HOGNBits;
+    return hog;
+}
+} // namespace
+
+vector<float> PlateCategory_SVM::ComputeHogDescriptors(const Mat &image) {
     vector<float> ret;
-    hog.compute(matToHog, ret, cv::Size(1, 1), cv::Size(0, 0));
+    GetHogExtractor().Compute(image, ret);
     return ret;
 }
+void PlateCategory_SVM::ComputeHogDescriptors(const Mat &image,
+                                              float *descriptor) {
+    GetHogExtractor().Compute(image, descriptor);
+}
+int PlateCategory_SVM::GetHogDescriptorSize() {
+    return GetHogExtractor().GetDescriptorSize();
+}
 bool PlateCategory_SVM::Train(Mat &samples, Mat &responses,
                       SVM::KernelTypes kernel,
                       float C, float gamma, float polyDegree,
@@ -75,19 +94,41 @@ bool PlateCategory_SVM::Train(Mat &samples, Mat &responses,
     svm->setDegree(polyDegree);
     svm->setGamma(gamma);
     IsReady = true;
-    return svm->train(samples, SampleTypes::ROW_SAMPLE, responses);
+    bool trained = svm->train(samples, SampleTypes::ROW_SAMPLE, responses);
+    predictor.Compile(svm);
+    return trained;
 }
-void PlateCategory_SVM::Save(const string &fileName) {
+void PlateCategory_SVM::Save(const string &fileName) const {
     if (IsReady == false || svm == nullptr)
         return;
     svm->save(fileName);
 }
+void PlateCategory_SVM::SaveBinary(const string &fileName) const {
+    if (IsReady == false || !predictor.IsCompiled())
+        return;
+    predictor.SaveBinary(fileName, GetHogParameters());
+}
 void PlateCategory_SVM::Load(const string &fileName) {
     try {
+        // SaveBinary 写出的模型直接映射，不再经过 SVM::load
+        if (SVMPredictor::IsBinaryModel(fileName)) {
+            HogParameters hog;
+            predictor.LoadBinary(fileName, hog);
+            if (hog != GetHogParameters()) {
+                predictor.Clear();
+                throw logic_error("hog parameters mismatch");
+            }
+            svm = nullptr;
+            IsReady = true;
+            return;
+        }
         svm = SVM::load(fileName);
+        predictor.Compile(svm);
         IsReady = true;
-    } catch (exception &) {
-        throw logic_error("char lib load exceptional, please check path");
+    } catch (exception &e) {
+        throw logic_error(
+            string("char lib load exceptional, please check path: ") +
+            e.what());
     }
 }
 bool PlateCategory_SVM::IsCorrectTrainngDirectory(const string &path) {
@@ -108,20 +149,23 @@ bool PlateCategory_SVM::IsCorrectTrainngDirectory(const string &path) {
     }
     return isCorrect;
 }
-PlateCategory_t PlateCategory_SVM::Test(Mat &matTest) {
+PlateCategory_t PlateCategory_SVM::Test(const Mat &matTest) const {
     try {
-        if (IsReady == false || svm == null) {
+        if (IsReady == false || (svm == null && !predictor.IsCompiled())) {
             throw logic_error("training data is null, please retrain plate type recognition or load data");
         }
 
         PlateCategory_t result = PlateCategory_t::NonPlate;
 
-        if (IsReady == false || svm == null)
+        if (IsReady == false || (svm == null && !predictor.IsCompiled()))
             return result;
-        vector<float> descriptor = ComputeHogDescriptors(matTest);
-        Mat testDescriptor = Mat::zeros(1, descriptor.size(), CV_32FC1);
-        for (size_t index = 0; index < descriptor.size(); index++) {
-            testDescriptor.at<float>(0, index) = descriptor[index];
+        // 每个候选区域都要判断一次，每个线程一份缓冲区，不再逐次分配
+        thread_local Mat testDescriptor(1, GetHogDescriptorSize(), CV_32FC1);
+        thread_local vector<int> labels;
+        ComputeHogDescriptors(matTest, testDescriptor.ptr<float>(0));
+        if (predictor.IsCompiled()) {
+            predictor.Predict(testDescriptor, labels);
+            return (PlateCategory_t)labels[0];
         }
         float predict = svm->predict(testDescriptor);
         result = (PlateCategory_t)((int)predict);
@@ -131,7 +175,7 @@ PlateCategory_t PlateCategory_SVM::Test(Mat &matTest) {
         throw ex;
     }
 }
-PlateCategory_t PlateCategory_SVM::Test(const string &fileName) {
+PlateCategory_t PlateCategory_SVM::Test(const string &fileName) const {
     Mat matTest = cv::imread(fileName, cv::ImreadModes::IMREAD_GRAYSCALE);
     return Test(matTest);
 }
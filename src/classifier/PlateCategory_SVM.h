@@ -40,45 +40,59 @@ enum class PlateCategory_t;
 } // namespace CV
 } // namespace Doit
 
+#include "HogExtractor.h"
+#include "SVMPredictor.h"
 #include "csharpImplementations.h"
 
 namespace Doit {
 namespace CV {
 namespace PlateRecogn {
+// 每个实例持有自己加载的模型。Train / Load 之后只调用 const 成员函数时，
+// 同一个实例可以被多个线程同时调用 Test。
 class PlateCategory_SVM {
 
   public:
-    static bool IsReady;
-    static cv::Size HOGWinSize;
-    static cv::Size HOGBlockSize;
-    static cv::Size HOGBlockStride;
-    static cv::Size HOGCellSize;
-    static int HOGNBits;
+    bool IsReady = false;
+    static const cv::Size HOGWinSize;
+    static const cv::Size HOGBlockSize;
+    static const cv::Size HOGBlockStride;
+    static const cv::Size HOGCellSize;
+    static const int HOGNBits;
 
   private:
-    static Ptr<SVM> svm;
-    static Random random;
+    Ptr<SVM> svm;
+    // Train / Load 时由 svm 展开，线性核会合并成权重矩阵，Test 优先使用
+    SVMPredictor predictor;
+    Random random;
 
   public:
     PlateCategory_SVM() {}
+    explicit PlateCategory_SVM(const string &fileName) { Load(fileName); }
     static void SavePlateSample(PlateInfo &plateInfo, string fileName);
-    static void SavePlateSample(Mat &matPlate, PlateCategory_t &plateCategory,
-                                string libPath);
+    // 样本文件名用到 random，不是线程安全的，只给采样工具使用
+    void SavePlateSample(Mat &matPlate, PlateCategory_t &plateCategory,
+                         string libPath);
     static void SavePlateSample(Mat &matPlate, PlateCategory_t plateCategory,
                                 string libPath, string shortFileNameNoExt);
 
     // use vector to replace array
-    static vector<float> ComputeHogDescriptors(Mat &image);
-    static bool Train(Mat &samples, Mat &responses,
-                      SVM::KernelTypes kernel = SVM::KernelTypes::LINEAR,
-                      float C = 1, float gamma = 1, float polyDegree = 1,
-                      unsigned long IterCount = 10000,
-                      long double epsilon = 1e-10);
-    static void Save(const string &fileName);
-    static void Load(const string &fileName);
+    static vector<float> ComputeHogDescriptors(const Mat &image);
+    // 写到 descriptor 里，至少 GetHogDescriptorSize() 个 float。
+    // 每个线程复用自己的 HogExtractor，稳定后不再分配内存
+    static void ComputeHogDescriptors(const Mat &image, float *descriptor);
+    static int GetHogDescriptorSize();
+    bool Train(Mat &samples, Mat &responses,
+               SVM::KernelTypes kernel = SVM::KernelTypes::LINEAR,
+               float C = 1, float gamma = 1, float polyDegree = 1,
+               unsigned long IterCount = 10000, long double epsilon = 1e-10);
+    void Save(const string &fileName) const;
+    // 展开后的模型存成二进制文件，Load 时直接内存映射，见 SVMPredictor
+    void SaveBinary(const string &fileName) const;
+    // 也可以加载 SaveBinary 的文件，HOG 参数不一致时抛出 logic_error
+    void Load(const string &fileName);
     static bool IsCorrectTrainngDirectory(const string &path);
-    static PlateCategory_t Test(Mat &matTest);
-    static PlateCategory_t Test(const string &fileName);
+    PlateCategory_t Test(const Mat &matTest) const;
+    PlateCategory_t Test(const string &fileName) const;
 
     static bool PreparePlateTrainningDirectory(const string &path);
 };
@@ -0,0 +1,239 @@
+#include "PlateCharCascade_SVM.h"
+#include "PlateChar_SVM.h"
+
+#include <algorithm>
+
+using namespace Doit::CV::PlateRecogn;
+
+using cv::TermCriteria;
+using cv::ml::SampleTypes;
+
+namespace {
+const char *GroupNodeName = "groups";
+
+string GetStageNodeName(int group) {
+    return "stage_" + std::to_string(group);
+}
+
+int GetFunctionCount(const SVMPredictor &predictor) {
+    int classCount = predictor.GetClassCount();
+    return classCount * (classCount - 1) / 2;
+}
+} // namespace
+
+bool PlateCharCascade_SVM::Train(const Mat &samples, const Mat &responses,
+                                 SVM::KernelTypes kernel, float C, float gamma,
+                                 unsigned long IterCount,
+                                 long double epsilon) {
+    CV_Assert(samples.type() == CV_32FC1 && responses.type() == CV_32SC1 &&
+              (int)responses.total() == samples.rows);
+    IsReady = false;
+    TermCriteria criteria(TermCriteria::Type::MAX_ITER, IterCount, epsilon);
+
+    // 第一级只需要分组，线性核就够了
+    Mat groupResponses(samples.rows, 1, CV_32SC1);
+    vector<int> rowsByGroup[CharGroupCount];
+    for (int row = 0; row < samples.rows; row++) {
+        int group = (int)GetCharGroup((PlateChar_t)responses.at<int>(row));
+        groupResponses.at<int>(row) = group;
+        rowsByGroup[group].push_back(row);
+    }
+    groupSvm = SVM::create();
+    groupSvm->setType(SVM::Types::C_SVC);
+    groupSvm->setKernel(SVM::KernelTypes::LINEAR);
+    groupSvm->setC(C);
+    groupSvm->setTermCriteria(criteria);
+    if (!groupSvm->train(samples, SampleTypes::ROW_SAMPLE, groupResponses))
+        return false;
+    groupPredictor.Compile(groupSvm);
+
+    for (int group = 0; group < CharGroupCount; group++) {
+        Stage &stage = stages[group];
+        stage = Stage();
+        const vector<int> &rows = rowsByGroup[group];
+        if (rows.empty())
+            continue;
+        Mat stageSamples((int)rows.size(), samples.cols, CV_32FC1);
+        Mat stageResponses((int)rows.size(), 1, CV_32SC1);
+        bool singleLabel = true;
+        for (size_t index = 0; index < rows.size(); index++) {
+            samples.row(rows[index]).copyTo(stageSamples.row((int)index));
+            stageResponses.at<int>((int)index) = responses.at<int>(rows[index]);
+            singleLabel = singleLabel && stageResponses.at<int>((int)index) ==
+                                             stageResponses.at<int>(0);
+        }
+        if (singleLabel) {
+            stage.Label = stageResponses.at<int>(0);
+            continue;
+        }
+
+        stage.svm = SVM::create();
+        stage.svm->setType(SVM::Types::C_SVC);
+        stage.svm->setKernel(kernel);
+        stage.svm->setC(C);
+        stage.svm->setGamma(gamma);
+        stage.svm->setTermCriteria(criteria);
+        if (!stage.svm->train(stageSamples, SampleTypes::ROW_SAMPLE,
+                              stageResponses))
+            return false;
+        stage.predictor.Compile(stage.svm);
+    }
+    IsReady = true;
+    return true;
+}
+
+void PlateCharCascade_SVM::Save(const string &fileName) const {
+    if (IsReady == false || groupSvm == nullptr)
+        return;
+    cv::FileStorage storage(fileName, cv::FileStorage::WRITE);
+    storage << GroupNodeName << "{";
+    groupSvm->write(storage);
+    storage << "}";
+    for (int group = 0; group < CharGroupCount; group++) {
+        const Stage &stage = stages[group];
+        string name = GetStageNodeName(group);
+        if (stage.svm != nullptr) {
+            storage << name << "{";
+            stage.svm->write(storage);
+            storage << "}";
+        } else if (stage.Label >= 0) {
+            storage << name + "_label" << stage.Label;
+        }
+    }
+}
+
+void PlateCharCascade_SVM::Load(const string &fileName) {
+    try {
+        IsReady = false;
+        cv::FileStorage storage(fileName, cv::FileStorage::READ);
+        if (!storage.isOpened())
+            throw logic_error("cannot open " + fileName);
+        groupSvm = SVM::create();
+        groupSvm->read(storage[GroupNodeName]);
+        if (!groupPredictor.Compile(groupSvm))
+            throw logic_error("invalid group model");
+
+        for (int group = 0; group < CharGroupCount; group++) {
+            Stage &stage = stages[group];
+            stage = Stage();
+            string name = GetStageNodeName(group);
+            cv::FileNode node = storage[name];
+            if (!node.empty()) {
+                stage.svm = SVM::create();
+                stage.svm->read(node);
+                if (!stage.predictor.Compile(stage.svm))
+                    throw logic_error("invalid stage model");
+            } else if (!storage[name + "_label"].empty()) {
+                stage.Label = (int)storage[name + "_label"];
+            }
+        }
+        IsReady = true;
+    } catch (exception &e) {
+        throw logic_error(string("级联字符识别库加载异常，请检查存放路径: ") +
+                          e.what());
+    }
+}
+
+PlateChar_t PlateCharCascade_SVM::Test(const Mat &matTest,
+                                       const PlateCharSet &allowed) const {
+    vector<PlateChar_t> results;
+    Test({matTest}, {allowed}, results);
+    return results[0];
+}
+
+void PlateCharCascade_SVM::Test(const vector<Mat> &matTests,
+                                const vector<PlateCharSet> &allowed,
+                                vector<PlateChar_t> &results) const {
+    if (IsReady == false) {
+        throw logic_error("training data is null, please retrain char "
+                          "recognition or load data");
+    }
+    Mat samples((int)matTests.size(), PlateChar_SVM::GetHogDescriptorSize(),
+                CV_32FC1);
+    for (size_t index = 0; index < matTests.size(); index++) {
+        PlateChar_SVM::ComputeHogDescriptors(matTests[index],
+                                             samples.ptr<float>((int)index));
+    }
+    Predict(samples, allowed, results);
+}
+
+void PlateCharCascade_SVM::Predict(const Mat &samples,
+                                   const vector<PlateCharSet> &allowed,
+                                   vector<PlateChar_t> &results) const {
+    CV_Assert(allowed.empty() || (int)allowed.size() == samples.rows);
+    results.assign(samples.rows, PlateChar_t::NonChar);
+    if (samples.rows == 0)
+        return;
+
+    // 第一级：排除没有允许类别的组和没有第二级模型的组
+    const vector<int> &groupLabels = groupPredictor.GetClassLabels();
+    Mat allowedGroups(samples.rows, (int)groupLabels.size(), CV_8UC1);
+    for (int row = 0; row < samples.rows; row++) {
+        CharGroupMask mask = 0;
+        if (allowed.empty()) {
+            mask = ~0u;
+        } else {
+            for (size_t value = 0; value < PlateCharCount; value++) {
+                if (allowed[row].test(value))
+                    mask |= ToCharGroupMask(GetCharGroup((PlateChar_t)value));
+            }
+        }
+        for (size_t k = 0; k < groupLabels.size(); k++) {
+            int group = groupLabels[k];
+            allowedGroups.at<uchar>(row, (int)k) =
+                (mask >> group & 1) != 0 && stages[group].IsReady();
+        }
+    }
+    vector<int> groupOfRows;
+    groupPredictor.Predict(samples, allowedGroups, groupOfRows);
+
+    // 第二级：同一组的字符一起预测
+    vector<int> rows;
+    vector<int> labels;
+    for (int group = 0; group < CharGroupCount; group++) {
+        const Stage &stage = stages[group];
+        rows.clear();
+        for (int row = 0; row < samples.rows; row++) {
+            if (groupOfRows[row] == group)
+                rows.push_back(row);
+        }
+        if (rows.empty() || !stage.IsReady())
+            continue;
+        if (stage.Label >= 0) {
+            for (int row : rows) {
+                results[row] = (PlateChar_t)stage.Label;
+            }
+            continue;
+        }
+        Mat stageSamples((int)rows.size(), samples.cols, CV_32FC1);
+        vector<PlateCharSet> stageAllowed;
+        for (size_t index = 0; index < rows.size(); index++) {
+            samples.row(rows[index]).copyTo(stageSamples.row((int)index));
+            if (!allowed.empty())
+                stageAllowed.push_back(allowed[rows[index]]);
+        }
+        if (stageAllowed.empty())
+            stage.predictor.Predict(stageSamples, labels);
+        else
+            stage.predictor.Predict(
+                stageSamples,
+                PlateChar_SVM::GetAllowedClasses(
+                    stage.predictor.GetClassLabels(), stageAllowed),
+                labels);
+        for (size_t index = 0; index < rows.size(); index++) {
+            results[rows[index]] = (PlateChar_t)labels[index];
+        }
+    }
+}
+
+int PlateCharCascade_SVM::GetGroupFunctionCount() const {
+    return GetFunctionCount(groupPredictor);
+}
+
+int PlateCharCascade_SVM::GetMaxStageFunctionCount() const {
+    int count = 0;
+    for (const Stage &stage : stages) {
+        count = std::max(count, GetFunctionCount(stage.predictor));
+    }
+    return count;
+}
@@ -0,0 +1,87 @@
+#ifndef PLATECHARCASCADE_SVM_H
+#define PLATECHARCASCADE_SVM_H
+
+#include <opencv2/core.hpp>
+#include <opencv2/ml.hpp>
+using cv::Mat;
+using cv::Ptr;
+using cv::ml::SVM;
+
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+#include <exception>
+using std::exception;
+using std::logic_error;
+
+#include "CharInfo.h"
+#include "SVMPredictor.h"
+
+namespace Doit {
+namespace CV {
+namespace PlateRecogn {
+/**
+ * 两级字符分类：第一级线性 SVM 把字符分到 CharGroup_t（非字符 / 数字 /
+ * 字母 / 汉字），第二级每组一个 SVM 只在组内的类别中决定字符。
+ *
+ * 73 个类别的一对一 SVM 每个字符要算 2600 多个决策函数，级联后第一级只有
+ * 6 个线性决策函数，第二级最多是汉字组的 595 个，支持向量也只有组内的。
+ * 调用者知道字符在车牌中的位置时可以用 PlateCharSet 限制可能的类别，
+ * 第一级只在包含允许类别的组中选，第二级只在允许的类别中投票。
+ *
+ * 特征与 PlateChar_SVM 相同。Train / Load 之后只调用 const 成员函数时，
+ * 同一个实例可以被多个线程同时调用 Test。
+ */
+class PlateCharCascade_SVM {
+  public:
+    bool IsReady = false;
+
+  private:
+    // 第二级的一个组。训练样本只有一个类别时不训练 SVM，直接给出 Label
+    struct Stage {
+        Ptr<SVM> svm;
+        SVMPredictor predictor;
+        int Label = -1;
+        bool IsReady() const { return predictor.IsCompiled() || Label >= 0; }
+    };
+
+    Ptr<SVM> groupSvm;
+    SVMPredictor groupPredictor;
+    // 按 CharGroup_t 索引
+    Stage stages[CharGroupCount];
+
+  public:
+    PlateCharCascade_SVM() {}
+    explicit PlateCharCascade_SVM(const string &fileName) { Load(fileName); }
+
+    // samples 是 PlateChar_SVM::ComputeHogDescriptors 的结果，每行一个；
+    // responses 是 PlateChar_t 的值 (CV_32S)。kernel 等参数用于第二级
+    bool Train(const Mat &samples, const Mat &responses,
+               SVM::KernelTypes kernel = SVM::KernelTypes::RBF, float C = 1,
+               float gamma = 1, unsigned long IterCount = 10000,
+               long double epsilon = 1e-10);
+    // 两级模型存在同一个 YAML 文件里
+    void Save(const string &fileName) const;
+    void Load(const string &fileName);
+
+    PlateChar_t Test(const Mat &matTest,
+                     const PlateCharSet &allowed = GetAllPlateChars()) const;
+    // allowed 为空时不限制，否则 allowed[i] 是 matTests[i] 可能的类别
+    void Test(const vector<Mat> &matTests, const vector<PlateCharSet> &allowed,
+              vector<PlateChar_t> &results) const;
+    // 已经算好 HOG 的样本，每行一个
+    void Predict(const Mat &samples, const vector<PlateCharSet> &allowed,
+                 vector<PlateChar_t> &results) const;
+
+    // 每个字符在第一级和第二级分别要算的一对一决策函数个数（取最大的组），
+    // 用来和单个 SVM 的 类别数 x (类别数 - 1) / 2 比较
+    int GetGroupFunctionCount() const;
+    int GetMaxStageFunctionCount() const;
+};
+
+} // namespace PlateRecogn
+} // namespace CV
+} // namespace Doit
+
+#endif // !PLATECHARCASCADE_SVM_H
@@ -1,30 +1,51 @@
 ﻿#include "CharInfo.h"
 #include "PlateChar_SVM.h"
+#include "StageTimer.h"
 
 using namespace Doit::CV::PlateRecogn;
 
-bool PlateChar_SVM::IsReady = false;
-cv::Size PlateChar_SVM::HOGWinSize = cv::Size(16, 32);
-cv::Size PlateChar_SVM::HOGBlockSize = cv::Size(16, 16);
-cv::Size PlateChar_SVM::HOGBlockStride = cv::Size(8, 8);
-cv::Size PlateChar_SVM::HOGCellSize = cv::Size(8, 8);
-int PlateChar_SVM::HOGNBits = 9;
-Ptr<SVM> PlateChar_SVM::svm = nullptr;
-Random PlateChar_SVM::random = Random();
+const cv::Size PlateChar_SVM::HOGWinSize = cv::Size(16, 32);
+const cv::Size PlateChar_SVM::HOGBlockSize = cv::Size(16, 16);
+const cv::Size PlateChar_SVM::HOGBlockStride = cv::Size(8, 8);
+const cv::Size PlateChar_SVM::HOGCellSize = cv::Size(8, 8);
+const int PlateChar_SVM::HOGNBits = 9;
 
-vector<float> PlateChar_SVM::ComputeHogDescriptors(Mat &image) {
-    Mat matToHog;
-    cv::resize(image, matToHog, HOGWinSize);
-    HOGDescriptor hog = HOGDescriptor(HOGWinSize, HOGBlockSize, HOGBlockStride,
-                                      HOGCellSize, HOGNBits);
+namespace {
+HogExtractor &GetHogExtractor() {
+    thread_local HogExtractor extractor(
+        PlateChar_SVM::HOGWinSize, PlateChar_SVM::HOGBlockSize,
+        PlateChar_SVM::HOGBlockStride, PlateChar_SVM::HOGCellSize,
+        PlateChar_SVM::HOGNBits);
+    return extractor;
+}
+HogParameters GetHogParameters() {
+    HogParameters hog;
+    hog.WinSize = PlateChar_SVM::HOGWinSize;
+    hog.BlockSize = PlateChar_SVM::HOGBlockSize;
+    hog.BlockStride = PlateChar_SVM::HOGBlockStride;
+    hog.CellSize = PlateChar_SVM::HOGCellSize;
+    hog.NBins = PlateChar_SVM::HOGNBits;
+    return hog;
+}
+} // namespace
+
+vector<float> PlateChar_SVM::ComputeHogDescriptors(const Mat &image) {
     vector<float> ret;
-    hog.compute(matToHog, ret, cv::Size(1, 1), cv::Size(0, 0));
+    GetHogExtractor().Compute(image, ret);
     return ret;
 }
-bool PlateChar_SVM::PlateChar_SVM::Train(Mat &samples, Mat &responses,
-                                         SVM::KernelTypes kernel, float C,
-                                         float gamma, float polyDegree, unsigned long IterCount,
-                                         long double epsilon) {
+void PlateChar_SVM::ComputeHogDescriptors(const Mat &image,
+                                          float *descriptor) {
+    StageTimer timer(PipelineStage_t::Hog);
+    GetHogExtractor().Compute(image, descriptor);
+}
+int PlateChar_SVM::GetHogDescriptorSize() {
+    return GetHogExtractor().GetDescriptorSize();
+}
+bool PlateChar_SVM::Train(Mat &samples, Mat &responses,
+                          SVM::KernelTypes kernel, float C, float gamma,
+                          float polyDegree, unsigned long IterCount,
+                          long double epsilon) {
     svm = SVM::create();
     svm->setType(SVM::Types::C_SVC);
     svm->setKernel(kernel);
@@ -36,21 +57,50 @@ bool PlateChar_SVM::PlateChar_SVM::Train(Mat &samples, Mat &responses,
         TermCriteria(TermCriteria::Type::MAX_ITER, IterCount, epsilon));
 
     IsReady = true;
-    return svm->train(samples, SampleTypes::ROW_SAMPLE, responses);
+    bool trained = svm->train(samples, SampleTypes::ROW_SAMPLE, responses);
+    predictor.Compile(svm);
+    return trained;
 }
-void PlateChar_SVM::Save(const string &fileName) {
+void PlateChar_SVM::Save(const string &fileName) const {
     if (IsReady == false || svm == nullptr)
         return;
     svm->save(fileName);
 }
-void PlateChar_SVM::Load(const string &fileName) {
+void PlateChar_SVM::SaveBinary(const string &fileName) const {
+    if (IsReady == false || !predictor.IsCompiled())
+        return;
+    predictor.SaveBinary(fileName, GetHogParameters());
+}
+void PlateChar_SVM::Load(const string &fileName, int nystromLandmarkCount) {
     try {
+        // SaveBinary 写出的模型直接映射，不再经过 SVM::load
+        if (SVMPredictor::IsBinaryModel(fileName)) {
+            HogParameters hog;
+            predictor.LoadBinary(fileName, hog);
+            if (hog != GetHogParameters()) {
+                predictor.Clear();
+                throw logic_error("hog parameters mismatch");
+            }
+            svm = nullptr;
+            IsReady = true;
+            return;
+        }
         svm = SVM::load(fileName);
+        if (nystromLandmarkCount > 0)
+            predictor.CompileNystrom(svm, nystromLandmarkCount);
+        else
+            predictor.Compile(svm);
         IsReady = true;
-    } catch (exception &) {
-        throw logic_error("字符识别库加载异常，请检查存放路径");
+    } catch (exception &e) {
+        throw logic_error(string("字符识别库加载异常，请检查存放路径: ") +
+                          e.what());
     }
 }
+bool PlateChar_SVM::Quantize(SVMPredictor::VectorStorage storage) {
+    if (IsReady == false)
+        return false;
+    return predictor.Quantize(storage);
+}
 bool PlateChar_SVM::IsCorrectTrainngDirectory(const string &path) {
     bool isCorrect = true;
     vector<const char *> plateCharNames(begin(PlateChar_tToString),
@@ -68,26 +118,120 @@ bool PlateChar_SVM::IsCorrectTrainngDirectory(const string &path) {
 
     return isCorrect;
 }
-PlateChar_t PlateChar_SVM::Test(Mat &matTest) {
-    if (IsReady == false || svm == null) {
+PlateChar_t PlateChar_SVM::Test(const Mat &matTest) const {
+    if (IsReady == false || (svm == null && !predictor.IsCompiled())) {
         throw logic_error("training data is null, please retrain plate type "
                           "recognition or load data");
     }
-    PlateChar_t result = PlateChar_t::NonChar;
-
-    vector<float> descriptor = ComputeHogDescriptors(matTest);
-    Mat testDescriptor = Mat::zeros(1, descriptor.size(), CV_32FC1);
-    for (size_t index = 0; index < descriptor.size(); index++) {
-        testDescriptor.at<float>(0, index) = descriptor[index];
+    // 与 HogExtractor 一样每个线程一份，逐个字符识别时不再分配内存
+    thread_local Mat testDescriptor(1, GetHogDescriptorSize(), CV_32FC1);
+    thread_local vector<int> labels;
+    ComputeHogDescriptors(matTest, testDescriptor.ptr<float>(0));
+    if (predictor.IsCompiled()) {
+        predictor.Predict(testDescriptor, labels);
+        return (PlateChar_t)labels[0];
     }
     float predict = svm->predict(testDescriptor);
-    result = (PlateChar_t)((int)predict);
-    return result;
+    return (PlateChar_t)((int)predict);
 }
-PlateChar_t PlateChar_SVM::Test(const string &fileName) {
+PlateChar_t PlateChar_SVM::Test(const string &fileName) const {
     Mat matTest = cv::imread(fileName, cv::ImreadModes::IMREAD_GRAYSCALE);
     return Test(matTest);
 }
+void PlateChar_SVM::Test(const vector<Mat> &matTests,
+                         vector<PlateChar_t> &results,
+                         Mat *decisionValues) const {
+    if (IsReady == false || (svm == null && !predictor.IsCompiled())) {
+        throw logic_error("training data is null, please retrain plate type "
+                          "recognition or load data");
+    }
+    results.clear();
+    if (matTests.empty()) {
+        if (decisionValues != nullptr)
+            decisionValues->release();
+        return;
+    }
+
+    // 每行一个字符的 HOG 描述子
+    Mat samples((int)matTests.size(), GetHogDescriptorSize(), CV_32FC1);
+    for (size_t index = 0; index < matTests.size(); index++) {
+        ComputeHogDescriptors(matTests[index], samples.ptr<float>((int)index));
+    }
+
+    if (predictor.IsCompiled()) {
+        vector<int> labels;
+        predictor.Predict(samples, labels, decisionValues);
+        for (int label : labels) {
+            results.push_back((PlateChar_t)label);
+        }
+        return;
+    }
+    // 展开失败的模型仍用 SVM::predict，此时没有决策值
+    Mat predicts;
+    svm->predict(samples, predicts);
+    for (int row = 0; row < predicts.rows; row++) {
+        results.push_back((PlateChar_t)((int)predicts.at<float>(row)));
+    }
+    if (decisionValues != nullptr)
+        decisionValues->release();
+}
+void PlateChar_SVM::Test(const vector<Mat> &matTests,
+                         const vector<PlateCharSet> &allowed,
+                         vector<PlateChar_t> &results) const {
+    if (allowed.empty()) {
+        Test(matTests, results);
+        return;
+    }
+    if (IsReady == false || (svm == null && !predictor.IsCompiled())) {
+        throw logic_error("training data is null, please retrain plate type "
+                          "recognition or load data");
+    }
+    if (!predictor.IsCompiled()) {
+        // SVM::predict 只给出最终的类别，没法只在部分类别之间投票
+        for (const PlateCharSet &plateChars : allowed) {
+            if (!plateChars.all())
+                throw logic_error("allowed chars need a compiled predictor, "
+                                  "the svm kernel is not supported");
+        }
+        Test(matTests, results);
+        return;
+    }
+    CV_Assert(allowed.size() == matTests.size());
+    results.clear();
+    if (matTests.empty())
+        return;
+
+    Mat samples((int)matTests.size(), GetHogDescriptorSize(), CV_32FC1);
+    for (size_t index = 0; index < matTests.size(); index++) {
+        ComputeHogDescriptors(matTests[index], samples.ptr<float>((int)index));
+    }
+    vector<int> labels;
+    predictor.Predict(samples,
+                      GetAllowedClasses(predictor.GetClassLabels(), allowed),
+                      labels);
+    for (int label : labels) {
+        results.push_back((PlateChar_t)label);
+    }
+}
+PlateChar_t PlateChar_SVM::Test(const Mat &matTest,
+                                const PlateCharSet &allowed) const {
+    vector<PlateChar_t> results;
+    Test({matTest}, {allowed}, results);
+    return results[0];
+}
+Mat PlateChar_SVM::GetAllowedClasses(const vector<int> &classLabels,
+                                     const vector<PlateCharSet> &allowed) {
+    Mat flags((int)allowed.size(), (int)classLabels.size(), CV_8UC1);
+    for (size_t row = 0; row < allowed.size(); row++) {
+        uchar *flag = flags.ptr<uchar>((int)row);
+        for (size_t k = 0; k < classLabels.size(); k++) {
+            int label = classLabels[k];
+            flag[k] = label >= 0 && label < (int)PlateCharCount &&
+                      allowed[row].test(label);
+        }
+    }
+    return flags;
+}
 void PlateChar_SVM::SaveCharSample(CharInfo &charInfo, const string &libPath) {
     DateTime now = DateTime::Now();
     ostringstream buffer;
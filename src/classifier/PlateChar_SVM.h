@@ -36,44 +36,81 @@ enum class PlateChar_t;
 } // namespace CV
 } // namespace Doit
 
+#include "CharInfo.h"
+#include "HogExtractor.h"
+#include "SVMPredictor.h"
 #include "csharpImplementations.h"
 
 namespace Doit {
 namespace CV {
 namespace PlateRecogn {
+// 每个实例持有自己加载的模型。Train / Load 之后只调用 const 成员函数时，
+// 同一个实例可以被多个线程同时调用 Test。
 class PlateChar_SVM {
   public:
-    static bool IsReady;
-    static cv::Size HOGWinSize;
-    static cv::Size HOGBlockSize;
-    static cv::Size HOGBlockStride;
-    static cv::Size HOGCellSize;
-    static int HOGNBits;
+    bool IsReady = false;
+    static const cv::Size HOGWinSize;
+    static const cv::Size HOGBlockSize;
+    static const cv::Size HOGBlockStride;
+    static const cv::Size HOGCellSize;
+    static const int HOGNBits;
 
   private:
-    static Ptr<SVM> svm;
-    static Random random;
+    Ptr<SVM> svm;
+    // Train / Load 时由 svm 展开，Test 优先使用
+    SVMPredictor predictor;
+    Random random;
 
   public:
-    static vector<float> ComputeHogDescriptors(Mat &image);
+    PlateChar_SVM() {}
+    explicit PlateChar_SVM(const string &fileName) { Load(fileName); }
+
+    static vector<float> ComputeHogDescriptors(const Mat &image);
+    // 写到 descriptor 里，至少 GetHogDescriptorSize() 个 float。
+    // 每个线程复用自己的 HogExtractor，稳定后不再分配内存
+    static void ComputeHogDescriptors(const Mat &image, float *descriptor);
+    static int GetHogDescriptorSize();
 
     // polyDegree 参数只在核函数是多项式时候其作用
-    static bool Train(Mat &samples, Mat &responses,
-                      SVM::KernelTypes kernel = SVM::KernelTypes::RBF,
-                      float C = 1, float gamma = 1, float polyDegree = 1,
-                      unsigned long IterCount = 10000,
-                      long double epsilon = 1e-10);
-    static void Save(const string &fileName);
-    static void Load(const string &fileName);
+    bool Train(Mat &samples, Mat &responses,
+               SVM::KernelTypes kernel = SVM::KernelTypes::RBF, float C = 1,
+               float gamma = 1, float polyDegree = 1,
+               unsigned long IterCount = 10000, long double epsilon = 1e-10);
+    void Save(const string &fileName) const;
+    // 展开后的模型存成二进制文件，Load 时直接内存映射，见 SVMPredictor
+    void SaveBinary(const string &fileName) const;
+    // nystromLandmarkCount > 0 时 RBF 模型换成这么多地标的 Nyström 近似，
+    // 预测更快但结果可能与原模型不同，见 SVMPredictor::CompileNystrom。
+    // 也可以加载 SaveBinary 的文件，此时忽略 nystromLandmarkCount，
+    // HOG 参数不一致时抛出 logic_error
+    void Load(const string &fileName, int nystromLandmarkCount = 0);
+    // 支持向量换成 int8 / fp16 存放，见 SVMPredictor::Quantize。
+    // 之后 SaveBinary 存的也是量化后的模型
+    bool Quantize(SVMPredictor::VectorStorage storage);
     static bool IsCorrectTrainngDirectory(const string &path);
-    static PlateChar_t Test(Mat &matTest);
-    static PlateChar_t Test(const string &fileName);
-    static void SaveCharSample(CharInfo &charInfo, const string &libPath);
+    PlateChar_t Test(const Mat &matTest) const;
+    PlateChar_t Test(const string &fileName) const;
+    // 一次预测所有字符，results[i] 对应 matTests[i]；decisionValues 不为空时
+    // 输出每个字符的一对一决策值，见 SVMPredictor::Predict
+    void Test(const vector<Mat> &matTests, vector<PlateChar_t> &results,
+              Mat *decisionValues = nullptr) const;
+    // allowed 为空时不限制，否则 allowed[i] 是 matTests[i] 可能的类别，
+    // 只在这些类别之间投票；展开失败（使用 SVM::predict）时不能限制类别，
+    // allowed 中有不是全部类别的项就抛出 logic_error
+    void Test(const vector<Mat> &matTests, const vector<PlateCharSet> &allowed,
+              vector<PlateChar_t> &results) const;
+    PlateChar_t Test(const Mat &matTest, const PlateCharSet &allowed) const;
+    // 转换成 SVMPredictor::Predict 的 allowed 参数，
+    // allowed.size() x classLabels.size() 的 CV_8UC1
+    static Mat GetAllowedClasses(const vector<int> &classLabels,
+                                 const vector<PlateCharSet> &allowed);
+    // 样本文件名用到 random，不是线程安全的，只给采样工具使用
+    void SaveCharSample(CharInfo &charInfo, const string &libPath);
     static void SaveCharSample(Mat &charMat, PlateChar_t plateChar,
                                const string &libPath,
                                const string &shortFileNameNoExt);
-    static void SaveCharSample(Mat &charMat, PlateChar_t plateChar,
-                               const string &libPath);
+    void SaveCharSample(Mat &charMat, PlateChar_t plateChar,
+                        const string &libPath);
     static bool PrepareCharTrainningDirectory(const string &path);
 };
 
@@ -0,0 +1,273 @@
+#include "PlateColorMask.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__SSE4_1__) || (defined(_MSC_VER) && defined(__AVX__))
+#include <smmintrin.h>
+#define PLATE_COLOR_MASK_SSE4_1
+#endif
+
+using namespace Doit::CV::PlateRecogn;
+
+namespace {
+// 与 OpenCV RGB2HSV_b (hrange = 180) 相同的定点参数和除法表
+const int hsv_shift = 12;
+
+struct HsvTables {
+    int SDiv[256];
+    int HDiv[256];
+    // diff 对应的色相分子 (h * 6 * diff / 180) 落在蓝色、黄色范围内的区间，
+    // 区间为空时 Low > High
+    int BlueLow[256];
+    int BlueHigh[256];
+    int YellowLow[256];
+    int YellowHigh[256];
+    // S >= SaturationMin 需要的最小 diff，v 对应的值都达不到时为 256
+    int SaturationMinDiff[256];
+    // 同一个 diff 的四个区间端点放在一起（蓝低、蓝高、黄低、黄高），
+    // 向量实现每个像素只读一次
+    int16_t HueBounds[256][4];
+
+    HsvTables() {
+        SDiv[0] = HDiv[0] = 0;
+        for (int i = 1; i < 256; i++) {
+            SDiv[i] = cv::saturate_cast<int>((255 << hsv_shift) / (1. * i));
+            HDiv[i] = cv::saturate_cast<int>((180 << hsv_shift) / (6. * i));
+        }
+
+        for (int diff = 0; diff < 256; diff++) {
+            BlueLow[diff] = YellowLow[diff] = 1;
+            BlueHigh[diff] = YellowHigh[diff] = 0;
+            bool blueFound = false, yellowFound = false;
+            // 分子的取值范围是 [-diff, 5 * diff]，h 随分子单调不减
+            for (int numerator = -diff; numerator <= 5 * diff; numerator++) {
+                int h = Hue(numerator, diff);
+                if (h >= PlateColorMask::BlueHueMin &&
+                    h <= PlateColorMask::BlueHueMax) {
+                    if (!blueFound)
+                        BlueLow[diff] = numerator;
+                    BlueHigh[diff] = numerator;
+                    blueFound = true;
+                }
+                if (h >= PlateColorMask::YellowHueMin &&
+                    h <= PlateColorMask::YellowHueMax) {
+                    if (!yellowFound)
+                        YellowLow[diff] = numerator;
+                    YellowHigh[diff] = numerator;
+                    yellowFound = true;
+                }
+            }
+            HueBounds[diff][0] = (int16_t)BlueLow[diff];
+            HueBounds[diff][1] = (int16_t)BlueHigh[diff];
+            HueBounds[diff][2] = (int16_t)YellowLow[diff];
+            HueBounds[diff][3] = (int16_t)YellowHigh[diff];
+        }
+
+        for (int v = 0; v < 256; v++) {
+            SaturationMinDiff[v] = 256;
+            for (int diff = 0; diff <= v; diff++) {
+                int s = (diff * SDiv[v] + (1 << (hsv_shift - 1))) >> hsv_shift;
+                if (s >= PlateColorMask::SaturationMin) {
+                    SaturationMinDiff[v] = diff;
+                    break;
+                }
+            }
+        }
+    }
+
+    int Hue(int numerator, int diff) const {
+        int h = (numerator * HDiv[diff] + (1 << (hsv_shift - 1))) >> hsv_shift;
+        h += h < 0 ? 180 : 0;
+        return cv::saturate_cast<uchar>(h);
+    }
+};
+
+const HsvTables &GetHsvTables() {
+    static const HsvTables tables;
+    return tables;
+}
+
+#if defined(PLATE_COLOR_MASK_SSE4_1)
+// 8 个像素一组，每个像素的 b, g, r, v, diff, 分子各占一个 16 位通道，
+// 计算与标量实现相同；只有按 diff 和 v 查表要逐个像素读
+void ComputeMaskRow(const uchar *src, uchar *dst, int count,
+                    const HsvTables &tables, const int16_t *minDiff) {
+    // 24 个字节中 b, g, r 的位置，前 16 个字节和后 8 个字节分开取
+    const __m128i bLow = _mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15,
+                                       -1, -1, -1, -1, -1);
+    const __m128i bHigh = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                        -1, -1, 2, -1, 5, -1);
+    const __m128i gLow = _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1,
+                                       -1, -1, -1, -1, -1);
+    const __m128i gHigh = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                        0, -1, 3, -1, 6, -1);
+    const __m128i rLow = _mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1, -1,
+                                       -1, -1, -1, -1, -1);
+    const __m128i rHigh = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                        1, -1, 4, -1, 7, -1);
+    alignas(16) uint16_t diffs[8];
+    alignas(16) uint16_t values[8];
+    for (int col = 0; col + 8 <= count; col += 8, src += 24, dst += 8) {
+        __m128i low = _mm_loadu_si128((const __m128i *)src);
+        __m128i high = _mm_loadl_epi64((const __m128i *)(src + 16));
+        __m128i b = _mm_or_si128(_mm_shuffle_epi8(low, bLow),
+                                 _mm_shuffle_epi8(high, bHigh));
+        __m128i g = _mm_or_si128(_mm_shuffle_epi8(low, gLow),
+                                 _mm_shuffle_epi8(high, gHigh));
+        __m128i r = _mm_or_si128(_mm_shuffle_epi8(low, rLow),
+                                 _mm_shuffle_epi8(high, rHigh));
+        __m128i v = _mm_max_epi16(_mm_max_epi16(b, g), r);
+        __m128i diff = _mm_sub_epi16(v, _mm_min_epi16(_mm_min_epi16(b, g), r));
+        __m128i diff2 = _mm_add_epi16(diff, diff);
+        // v == r 优先，其次 v == g，与标量实现的顺序相同
+        __m128i numerator = _mm_add_epi16(_mm_sub_epi16(r, g),
+                                          _mm_add_epi16(diff2, diff2));
+        numerator = _mm_blendv_epi8(
+            numerator, _mm_add_epi16(_mm_sub_epi16(b, r), diff2),
+            _mm_cmpeq_epi16(v, g));
+        numerator = _mm_blendv_epi8(numerator, _mm_sub_epi16(g, b),
+                                    _mm_cmpeq_epi16(v, r));
+
+        _mm_store_si128((__m128i *)diffs, diff);
+        _mm_store_si128((__m128i *)values, v);
+        __m128i bounds[8];
+        for (int k = 0; k < 8; k++) {
+            bounds[k] =
+                _mm_loadl_epi64((const __m128i *)tables.HueBounds[diffs[k]]);
+        }
+        __m128i saturationMinDiff = _mm_setr_epi16(
+            minDiff[values[0]], minDiff[values[1]], minDiff[values[2]],
+            minDiff[values[3]], minDiff[values[4]], minDiff[values[5]],
+            minDiff[values[6]], minDiff[values[7]]);
+        // 8 x 4 转置成蓝低、蓝高、黄低、黄高四个向量
+        __m128i t0 = _mm_unpacklo_epi16(bounds[0], bounds[1]);
+        __m128i t1 = _mm_unpacklo_epi16(bounds[2], bounds[3]);
+        __m128i t2 = _mm_unpacklo_epi16(bounds[4], bounds[5]);
+        __m128i t3 = _mm_unpacklo_epi16(bounds[6], bounds[7]);
+        __m128i blue0 = _mm_unpacklo_epi32(t0, t1);
+        __m128i yellow0 = _mm_unpackhi_epi32(t0, t1);
+        __m128i blue1 = _mm_unpacklo_epi32(t2, t3);
+        __m128i yellow1 = _mm_unpackhi_epi32(t2, t3);
+        __m128i blueLow = _mm_unpacklo_epi64(blue0, blue1);
+        __m128i blueHigh = _mm_unpackhi_epi64(blue0, blue1);
+        __m128i yellowLow = _mm_unpacklo_epi64(yellow0, yellow1);
+        __m128i yellowHigh = _mm_unpackhi_epi64(yellow0, yellow1);
+
+        // 区间外：分子小于下限或大于上限
+        __m128i outBlue = _mm_or_si128(_mm_cmpgt_epi16(blueLow, numerator),
+                                       _mm_cmpgt_epi16(numerator, blueHigh));
+        __m128i outYellow =
+            _mm_or_si128(_mm_cmpgt_epi16(yellowLow, numerator),
+                         _mm_cmpgt_epi16(numerator, yellowHigh));
+        __m128i rejected =
+            _mm_or_si128(_mm_and_si128(outBlue, outYellow),
+                         _mm_cmpgt_epi16(saturationMinDiff, diff));
+        __m128i mask = _mm_andnot_si128(rejected, _mm_set1_epi16(-1));
+        _mm_storel_epi64((__m128i *)dst, _mm_packs_epi16(mask, mask));
+    }
+}
+#endif
+} // namespace
+
+void PlateColorMask::AccumulateValueHistogram(const Mat &matSource,
+                                              int *histogram) {
+    CV_Assert(matSource.type() == CV_8UC3);
+    // 4 个子直方图交替累加，减少相邻像素落在同一个格子时的写依赖
+    int subHistograms[4][256] = {};
+    for (int row = 0; row < matSource.rows; row++) {
+        const uchar *src = matSource.ptr<uchar>(row);
+        int col = 0;
+        for (; col + 4 <= matSource.cols; col += 4, src += 12) {
+            subHistograms[0][std::max(std::max(src[0], src[1]), src[2])]++;
+            subHistograms[1][std::max(std::max(src[3], src[4]), src[5])]++;
+            subHistograms[2][std::max(std::max(src[6], src[7]), src[8])]++;
+            subHistograms[3][std::max(std::max(src[9], src[10]), src[11])]++;
+        }
+        for (; col < matSource.cols; col++, src += 3) {
+            subHistograms[0][std::max(std::max(src[0], src[1]), src[2])]++;
+        }
+    }
+    for (int i = 0; i < 256; i++) {
+        histogram[i] += subHistograms[0][i] + subHistograms[1][i] +
+                        subHistograms[2][i] + subHistograms[3][i];
+    }
+}
+
+void PlateColorMask::BuildEqualizeLut(const int *histogram, uchar *lut) {
+    // 与 cv::equalizeHist 的计算方式一致
+    int total = 0;
+    for (int i = 0; i < 256; i++) {
+        total += histogram[i];
+        lut[i] = 0;
+    }
+    if (total == 0)
+        return;
+    int i = 0;
+    while (!histogram[i])
+        ++i;
+    if (histogram[i] == total) {
+        // 只有一种亮度时 equalizeHist 把整幅图设成这个值
+        lut[i] = (uchar)i;
+        return;
+    }
+    float scale = (256 - 1.f) / (total - histogram[i]);
+    int sum = 0;
+    for (lut[i++] = 0; i < 256; ++i) {
+        sum += histogram[i];
+        lut[i] = cv::saturate_cast<uchar>(sum * scale);
+    }
+}
+
+void PlateColorMask::ComputeMask(const Mat &matSource, const uchar *valueLut,
+                                 Mat &mask) {
+    CV_Assert(matSource.type() == CV_8UC3);
+    const HsvTables &tables = GetHsvTables();
+    // 把均衡化后的 V 范围并进 S 的最小 diff 表，逐像素只剩一次查表比较
+    int minDiff[256];
+    for (int v = 0; v < 256; v++) {
+        minDiff[v] = valueLut[v] >= ValueMin ? tables.SaturationMinDiff[v] : 256;
+    }
+
+#if defined(PLATE_COLOR_MASK_SSE4_1)
+    int16_t minDiff16[256];
+    for (int v = 0; v < 256; v++) {
+        minDiff16[v] = (int16_t)minDiff[v];
+    }
+    const int vectorCols = matSource.cols / 8 * 8;
+#else
+    const int vectorCols = 0;
+#endif
+
+    mask.create(matSource.size(), CV_8UC1);
+    for (int row = 0; row < matSource.rows; row++) {
+        const uchar *src = matSource.ptr<uchar>(row);
+        uchar *dst = mask.ptr<uchar>(row);
+#if defined(PLATE_COLOR_MASK_SSE4_1)
+        ComputeMaskRow(src, dst, vectorCols, tables, minDiff16);
+        src += vectorCols * 3;
+#endif
+        for (int col = vectorCols; col < matSource.cols; col++, src += 3) {
+            int b = src[0], g = src[1], r = src[2];
+            int v = std::max(std::max(b, g), r);
+            int diff = v - std::min(std::min(b, g), r);
+            int numerator = v == r   ? g - b
+                            : v == g ? b - r + 2 * diff
+                                     : r - g + 4 * diff;
+            bool inRange = diff >= minDiff[v] &&
+                           ((numerator >= tables.BlueLow[diff] &&
+                             numerator <= tables.BlueHigh[diff]) |
+                            (numerator >= tables.YellowLow[diff] &&
+                             numerator <= tables.YellowHigh[diff]));
+            dst[col] = inRange ? 255 : 0;
+        }
+    }
+}
+
+void PlateColorMask::Compute(const Mat &matSource, Mat &mask) {
+    int histogram[256] = {};
+    uchar lut[256];
+    AccumulateValueHistogram(matSource, histogram);
+    BuildEqualizeLut(histogram, lut);
+    ComputeMask(matSource, lut, mask);
+}
@@ -0,0 +1,51 @@
+#ifndef PLATE_COLOR_MASK_H
+#define PLATE_COLOR_MASK_H
+
+#include <opencv2/core.hpp>
+using cv::Mat;
+
+namespace Doit {
+namespace CV {
+namespace PlateRecogn {
+
+/**
+ * 蓝色 + 黄色车牌的颜色掩码，直接从 BGR 计算。
+ *
+ * 结果和原来的 BGR2HSV -> split -> equalizeHist(V) -> merge -> inRange(蓝)
+ * + inRange(黄) -> Otsu 完全一样，但只需要读两遍原图：第一遍统计 V 的
+ * 直方图，第二遍用 V 的均衡化查找表和预先算好的 H、S 区间表逐像素判断。
+ * Otsu 作用在只有 0 和 255 的图上得到的阈值是 0，不改变掩码，所以不再需要。
+ * 打开 SSE4.1 编译时第二遍 8 个像素一组做区间比较，结果与标量实现相同。
+ *
+ * 两遍可以分开调用：各部分的直方图相加后再建查找表，就可以分块并行生成掩码。
+ */
+class PlateColorMask {
+  public:
+    // 与 PlateLocator_V3 原来 inRange 使用的范围一致，上下限都包含
+    static constexpr int BlueHueMin = 100;
+    static constexpr int BlueHueMax = 140;
+    static constexpr int YellowHueMin = 15;
+    static constexpr int YellowHueMax = 40;
+    static constexpr int SaturationMin = 70;
+    static constexpr int ValueMin = 70;
+
+  public:
+    // 把 matSource (CV_8UC3, BGR) 的 V = max(b, g, r) 累加到 histogram[256]
+    static void AccumulateValueHistogram(const Mat &matSource, int *histogram);
+
+    // 由 V 的直方图生成与 cv::equalizeHist 相同的查找表 lut[256]
+    static void BuildEqualizeLut(const int *histogram, uchar *lut);
+
+    // 用均衡化查找表生成掩码（CV_8UC1，0 或 255），mask 尺寸与 matSource 相同
+    static void ComputeMask(const Mat &matSource, const uchar *valueLut,
+                            Mat &mask);
+
+    // 直方图 + 查找表 + 掩码
+    static void Compute(const Mat &matSource, Mat &mask);
+};
+
+} // namespace PlateRecogn
+} // namespace CV
+} // namespace Doit
+
+#endif // !PLATE_COLOR_MASK_H
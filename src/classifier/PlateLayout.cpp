@@ -0,0 +1,147 @@
+#include "PlateLayout.h"
+
+#include <algorithm>
+#include <climits>
+
+using namespace Doit::CV::PlateRecogn;
+
+namespace {
+PlateCharSet GetSinglePlateChar(PlateChar_t plateChar) {
+    PlateCharSet plateChars;
+    plateChars.set((size_t)plateChar);
+    return plateChars;
+}
+
+// 省份简称，不包括港、澳、警
+PlateCharSet GetProvinces() {
+    PlateCharSet provinces =
+        GetPlateCharSet(PlateChar_t::BeiJing, PlateChar_t::SiChuan);
+    provinces.reset((size_t)PlateChar_t::XiangGang);
+    provinces.reset((size_t)PlateChar_t::AoMen);
+    return provinces;
+}
+
+// head 之后接 count 个字母或数字，再接 tail
+vector<PlateCharSet> MakeSlots(const vector<PlateCharSet> &head, size_t count,
+                               const vector<PlateCharSet> &tail = {}) {
+    PlateCharSet alphanumerics =
+        GetPlateCharSet(PlateChar_t::A, PlateChar_t::Z) |
+        GetPlateCharSet(PlateChar_t::_0, PlateChar_t::_9);
+    vector<PlateCharSet> slots = head;
+    slots.insert(slots.end(), count, alphanumerics);
+    slots.insert(slots.end(), tail.begin(), tail.end());
+    return slots;
+}
+} // namespace
+
+const PlateLayout &PlateLayout::Get(PlateCategory_t plateCategory) {
+    static const PlateCharSet letters =
+        GetPlateCharSet(PlateChar_t::A, PlateChar_t::Z);
+    // 粤A 12345
+    static const PlateLayout normal(MakeSlots({GetProvinces(), letters}, 5),
+                                    false);
+    // 粤A 1234警
+    static const PlateLayout police(
+        MakeSlots({GetProvinces(), letters}, 4,
+                  {GetSinglePlateChar(PlateChar_t::JingChe)}),
+        false);
+    // 粤A D12345
+    static const PlateLayout alternativeEnergy(
+        MakeSlots({GetProvinces(), letters}, 6), false);
+    // 粤Z 1234港 / 粤Z 1234澳
+    static const PlateLayout internal(
+        MakeSlots({GetSinglePlateChar(PlateChar_t::GuangDong),
+                   GetSinglePlateChar(PlateChar_t::Z)},
+                  4,
+                  {GetSinglePlateChar(PlateChar_t::XiangGang) |
+                   GetSinglePlateChar(PlateChar_t::AoMen)}),
+        false);
+    static const PlateLayout variable(vector<PlateCharSet>(), true);
+    static const PlateLayout unrestricted;
+
+    switch (plateCategory) {
+    case PlateCategory_t::NonPlate:
+        return unrestricted;
+    case PlateCategory_t::NormalPlate:
+    case PlateCategory_t::NormalPlate2Row:
+        return normal;
+    case PlateCategory_t::PolicePlate:
+        return police;
+    case PlateCategory_t::AlternativeEnergyPlate:
+        return alternativeEnergy;
+    case PlateCategory_t::MacaoPlateInternal:
+    case PlateCategory_t::HongkongPlateInternal:
+        return internal;
+    default:
+        return variable;
+    }
+}
+
+vector<PlateCharSet> PlateLayout::GetAllowedChars(size_t charCount) const {
+    vector<PlateCharSet> allowed(charCount, GetAllPlateChars());
+    if (slots.empty()) {
+        if (hanziOnlyAtEnds && charCount >= 4) {
+            PlateCharSet withoutHanzi = ~GetPlateCharSet(CharGroup_t::Hanzi);
+            for (size_t index = 2; index + 1 < charCount; index++) {
+                allowed[index] = withoutHanzi;
+            }
+        }
+        return allowed;
+    }
+
+    // 个数相同时也可能是漏了一个、多了一个（例如漏掉汉字、边上多一个噪声），
+    // 窗口两边再各放宽 SlotSlack 个位置
+    const size_t SlotSlack = 1;
+    size_t slotCount = slots.size();
+    size_t extra = charCount > slotCount ? charCount - slotCount : 0;
+    size_t missing = charCount < slotCount ? slotCount - charCount : 0;
+    for (size_t index = 0; index < charCount; index++) {
+        size_t first =
+            index > extra + SlotSlack ? index - extra - SlotSlack : 0;
+        size_t last = std::min(index + missing + SlotSlack, slotCount - 1);
+        // 非字符和点（省份与序号之间的分隔点）可以出现在任何位置
+        PlateCharSet plateChars = GetSinglePlateChar(PlateChar_t::NonChar) |
+                                  GetSinglePlateChar(PlateChar_t::Point);
+        for (size_t slot = first; slot <= last; slot++) {
+            plateChars |= slots[slot];
+        }
+        allowed[index] = plateChars;
+    }
+    return allowed;
+}
+
+void PlateLayout::Trim(vector<CharInfo> &charInfos) const {
+    size_t charCount = charInfos.size(), slotCount = slots.size();
+    if (slots.empty() || charCount <= slotCount)
+        return;
+
+    // best[i][j]: 前 i 个字符中按顺序取 j 个放到前 j 个位置时最多吻合几个
+    const int impossible = INT_MIN / 2;
+    vector<vector<int>> best(charCount + 1,
+                             vector<int>(slotCount + 1, impossible));
+    for (size_t i = 0; i <= charCount; i++) {
+        best[i][0] = 0;
+    }
+    for (size_t i = 1; i <= charCount; i++) {
+        for (size_t j = 1; j <= std::min(i, slotCount); j++) {
+            int match =
+                slots[j - 1].test((size_t)charInfos[i - 1].PlateChar) ? 1 : 0;
+            best[i][j] = std::max(best[i - 1][j], best[i - 1][j - 1] + match);
+        }
+    }
+
+    // 从后往前回溯，去掉第 i 个字符不影响吻合数时就去掉它
+    vector<bool> keep(charCount, false);
+    for (size_t i = charCount, j = slotCount; j > 0; i--) {
+        if (i > j && best[i - 1][j] == best[i][j])
+            continue;
+        keep[i - 1] = true;
+        j--;
+    }
+    vector<CharInfo> trimmed;
+    for (size_t index = 0; index < charCount; index++) {
+        if (keep[index])
+            trimmed.push_back(charInfos[index]);
+    }
+    charInfos.swap(trimmed);
+}
@@ -0,0 +1,52 @@
+#ifndef PLATE_LAYOUT_H
+#define PLATE_LAYOUT_H
+
+#include <vector>
+using std::vector;
+
+#include "CharInfo.h"
+
+namespace Doit {
+namespace CV {
+namespace PlateRecogn {
+/**
+ * 车牌类型的字符版式：每个位置可能出现的类别，例如普通车牌是
+ * 省份 + 字母 + 5 个字母或数字。
+ *
+ * 切分出的字符个数与版式不一定相同（边上的噪声、漏掉的汉字），第 i 个
+ * 切分结果可能对应版式中 [i - 多出的个数 - 1, i + 缺少的个数 + 1] 的位置
+ * （噪声和漏字同时出现时个数可能恰好相同，所以两边各多放宽一个），
+ * 允许的类别是这些位置的并集再加上非字符和点。识别时每个字符只在允许的类别
+ * 之间投票，之后去掉非字符，个数仍然多于版式时保留与版式最吻合的字符。
+ *
+ * 没有固定版式的车牌类型（港澳本地、军牌等）只规定汉字不会出现在中间
+ * （前两个和最后一个之外），非车牌不做限制。
+ */
+class PlateLayout {
+  public:
+    static const PlateLayout &Get(PlateCategory_t plateCategory);
+
+    bool IsFixed() const { return !slots.empty(); }
+    size_t GetSlotCount() const { return slots.size(); }
+    const PlateCharSet &GetSlot(size_t index) const { return slots[index]; }
+
+    // charCount 个切分结果（从左到右）各自允许的类别
+    vector<PlateCharSet> GetAllowedChars(size_t charCount) const;
+    // charInfos 已经去掉非字符。多于版式字符数时，保留与版式位置吻合最多的
+    // 那些字符，吻合数相同时优先去掉靠后的
+    void Trim(vector<CharInfo> &charInfos) const;
+
+  private:
+    PlateLayout() {}
+    PlateLayout(const vector<PlateCharSet> &slots, bool hanziOnlyAtEnds)
+        : slots(slots), hanziOnlyAtEnds(hanziOnlyAtEnds) {}
+
+    vector<PlateCharSet> slots;
+    // 没有固定版式时，中间的字符不会是汉字
+    bool hanziOnlyAtEnds = false;
+};
+} // namespace PlateRecogn
+} // namespace CV
+} // namespace Doit
+
+#endif // !PLATE_LAYOUT_H
@@ -1,9 +1,13 @@
 #include "CharInfo.h"
 #include "PlateCategory_SVM.h"
+#include "PlateColorMask.h"
 #include "PlateLocator_V3.h"
+#include "StageTimer.h"
+#include "ThreadPool.h"
 #include "Utilities.h"
 
 using cv::Point;
+#include <algorithm>
 #include <utility>
 using std::get;
 using std::tuple;
@@ -25,367 +29,674 @@ bool PlateLocator_V3::VerifyPlateSize(const cv::Size &size, int minWidth,
     return result;
 }
 
-vector<PlateInfo> PlateLocator_V3::LocatePlatesForCameraAdjust(
-    const Mat &matSource, Mat &matProcess, int blur_Size, int sobel_Scale,
-    int sobel_Delta, int sobel_X_Weight, int sobel_Y_Weight,
-    int morph_Size_Width, int morph_Size_Height, int minWidth, int maxWidth,
-    int minHeight, int maxHeight, float minRatio, float maxRatio) {
-    auto ret = LocatePlatesForAutoSample(
-        matSource, matProcess, blur_Size, sobel_Scale, sobel_Delta,
-        sobel_X_Weight, sobel_Y_Weight, morph_Size_Width, morph_Size_Height,
-        minWidth, maxWidth, minHeight, maxHeight, minRatio, maxRatio);
-    auto plateInfos = get<0>(ret[0]);
-    for (size_t index = plateInfos.size() - 1; index < plateInfos.size();
-         index--) {
-        if (plateInfos[index].PlateCategory == PlateCategory_t::NonPlate)
-            plateInfos.erase(plateInfos.begin() + index);
-    }
-    return plateInfos;
+PlateLocatorPipeline::PlateLocatorPipeline(
+    const PlateCategory_SVM &plateCategorySVM, const PlateLocatorConfig &config)
+    : plateCategorySVM(plateCategorySVM), config(config),
+      scratch(ownedScratch) {}
+
+PlateLocatorPipeline::PlateLocatorPipeline(
+    const PlateCategory_SVM &plateCategorySVM, const PlateLocatorConfig &config,
+    PlateLocatorScratch &scratch)
+    : plateCategorySVM(plateCategorySVM), config(config), scratch(scratch) {}
+
+void PlateLocatorPipeline::SetSource(const Mat &matSource,
+                                     const Mat &regionMask) {
+    this->matSource = matSource;
+    this->regionMask = regionMask;
+    hasColorThreshold = hasColorErode = false;
+    hasColorContours = hasColorPlateInfos = false;
+    hasSobelThreshold = hasSobelErode = false;
+    hasSobelContours = hasSobelPlateInfos = false;
+    colorPlateInfos.clear();
+    sobelPlateInfos.clear();
 }
 
-// color:  PlateInfos, threshold, after erode and close, contours, rected
-// sobel(optional): PlateInfos, threshold, after erode and close, contours, rected
-vector<tuple<vector<PlateInfo>, Mat, Mat, vector<vector<Point>>, Mat>>
-PlateLocator_V3::LocatePlatesForAutoSample(
-    const Mat &matSource, Mat &matProcess, int blur_Size, int sobel_Scale,
-    int sobel_Delta, int sobel_X_Weight, int sobel_Y_Weight,
-    int morph_Size_Width, int morph_Size_Height, int minWidth, int maxWidth,
-    int minHeight, int maxHeight, float minRatio, float maxRatio) {
-    vector<PlateInfo> plateInfosForColor = vector<PlateInfo>();
-    //优先使⽤颜⾊法定位可能是⻋牌的区域，如果没有发现⻋牌，再使⽤Sobel法
-    Mat gray;
-    Mat blur;
-    if (matSource.empty() || matSource.rows == 0 || matSource.cols == 0) {
-        matProcess = Mat(0, 0, CV_8UC1);
-        return {{}, {}, {}, {}, {}};
+void PlateLocatorPipeline::SetTaskPool(ThreadPool *taskPool) {
+    this->taskPool = taskPool;
+}
+
+bool PlateLocatorPipeline::UseBands() const {
+    // 横条太窄时上下多算的行比横条本身还多，不值得分块
+    return taskPool != nullptr && config.BandCount > 1 &&
+           matSource.rows >= config.BandCount * 64;
+}
+
+vector<cv::Range> PlateLocatorPipeline::GetBands() const {
+    vector<cv::Range> bands;
+    int bandCount = std::max(config.BandCount, 1);
+    for (int index = 0; index < bandCount; index++) {
+        bands.push_back(cv::Range(matSource.rows * index / bandCount,
+                                  matSource.rows * (index + 1) / bandCount));
     }
-    cvtColor(matSource, gray, cv::COLOR_BGR2GRAY);
-    GaussianBlur(gray, blur, cv::Size(blur_Size, blur_Size), 0, 0,
-                 cv::BorderTypes::BORDER_DEFAULT);
-    Mat hsv;
-    cv::cvtColor(matSource, hsv, cv::COLOR_BGR2HSV);
-    vector<Mat> hsvSplits;
-    split(hsv, hsvSplits);
-    equalizeHist(hsvSplits[2], hsvSplits[2]);
-    Mat hsvEqualizeHist;
-    merge(hsvSplits, hsvEqualizeHist);
-    Scalar blueStart = cv::Scalar(100, 70, 70);
-    Scalar blueEnd = cv::Scalar(140, 255, 255);
-    Mat blue;
-    cv::inRange(hsvEqualizeHist, blueStart, blueEnd, blue);
-    Scalar yellowStart = Scalar(15, 70, 70);
-    Scalar yellowEnd = Scalar(40, 255, 255);
-    Mat yellow;
-    cv::inRange(hsvEqualizeHist, yellowStart, yellowEnd, yellow);
-    Mat add = blue + yellow;
-    Mat thresholdForColor;
-    cv::threshold(add, thresholdForColor, 0, 255,
-                  cv::ThresholdTypes::THRESH_OTSU |
-                      cv::ThresholdTypes::THRESH_BINARY);
+    return bands;
+}
+
+void PlateLocatorPipeline::CloseAndErode(const Mat &threshold, Mat &close,
+                                         Mat &erode, int erodeSize) const {
     Mat element = cv::getStructuringElement(
         cv::MorphShapes::MORPH_RECT,
-        cv::Size(morph_Size_Width, morph_Size_Height));
-    Mat threshold_Close;
-    cv::morphologyEx(thresholdForColor, threshold_Close,
-                     cv::MorphTypes::MORPH_CLOSE, element);
-    Mat element_Erode =
-        cv::getStructuringElement(cv::MorphShapes::MORPH_RECT, cv::Size(3, 3));
-    Mat threshold_ErodeForColor;
-    cv::erode(threshold_Close, threshold_ErodeForColor, element_Erode);
-    matProcess = threshold_ErodeForColor;
-    vector<vector<cv::Point>> contoursForColor;
-    vector<cv::Vec4i> hierarchys;
-    cv::findContours(threshold_ErodeForColor, contoursForColor, hierarchys,
-                     cv::RetrievalModes::RETR_EXTERNAL,
-                     cv::ContourApproximationModes::CHAIN_APPROX_NONE);
-    int isPlateCount = 0;
-    for (size_t index = 0; index < contoursForColor.size(); index++) {
-        RotatedRect rotatedRect = cv::minAreaRect(contoursForColor[index]);
-        Rect rectROI = cv::boundingRect(contoursForColor[index]);
-        if (VerifyPlateSize(rectROI.size(), minWidth, maxWidth, minHeight,
-                            maxHeight, minRatio, maxRatio)) {
-            Mat matROI = matSource(rectROI);
-
-            PlateCategory_t plateCategory = PlateCategory_SVM::Test(matROI);
-            if (plateCategory != PlateCategory_t::NonPlate)
-                isPlateCount++;
-            PlateInfo plateInfo;
-            plateInfo.RotatedRect = rotatedRect;
-            plateInfo.OriginalRect = rectROI;
-            plateInfo.OriginalMat = matROI;
-            plateInfo.PlateCategory = plateCategory;
-            plateInfo.PlateLocateMethod = PlateLocateMethod_t::Color;
-            plateInfosForColor.push_back(plateInfo);
+        cv::Size(config.MorphSizeWidth, config.MorphSizeHeight));
+    Mat element_Erode = cv::getStructuringElement(
+        cv::MorphShapes::MORPH_RECT, cv::Size(erodeSize, erodeSize));
+    if (!UseBands()) {
+        cv::morphologyEx(threshold, close, cv::MorphTypes::MORPH_CLOSE,
+                         element);
+        cv::erode(close, erode, element_Erode);
+        return;
+    }
+
+    // 膨胀、腐蚀、再腐蚀，每一步最多影响核高度那么多行，横条上下各多算这些行，
+    // 中间部分就和整幅图计算的结果一样。多算的行只在图像内部，图像上下边缘
+    // 仍然使用 OpenCV 默认的边界处理
+    int halo = config.MorphSizeHeight + erodeSize;
+    vector<cv::Range> bands = GetBands();
+    close.create(threshold.size(), CV_8UC1);
+    erode.create(threshold.size(), CV_8UC1);
+    taskPool->ParallelFor(bands.size(), [&](size_t index, size_t) {
+        cv::Range band = bands[index];
+        int start = std::max(band.start - halo, 0);
+        int end = std::min(band.end + halo, threshold.rows);
+        // 先复制出来，避免 OpenCV 读取 ROI 以外的像素
+        Mat bandThreshold = threshold.rowRange(start, end).clone();
+        Mat bandClose, bandErode;
+        cv::morphologyEx(bandThreshold, bandClose,
+                         cv::MorphTypes::MORPH_CLOSE, element);
+        cv::erode(bandClose, bandErode, element_Erode);
+        cv::Range inner(band.start - start, band.end - start);
+        bandClose.rowRange(inner).copyTo(close.rowRange(band));
+        bandErode.rowRange(inner).copyTo(erode.rowRange(band));
+    });
+}
+
+vector<PlateInfo> PlateLocatorPipeline::LocatePlates() {
+    vector<PlateInfo> plateInfos = vector<PlateInfo>();
+    if (matSource.empty())
+        return plateInfos;
+    //优先使⽤颜⾊法定位可能是⻋牌的区域，如果没有发现⻋牌，再使⽤Sobel法
+    for (auto &plateInfo : GetColorPlateInfos()) {
+        if (plateInfo.PlateCategory != PlateCategory_t::NonPlate)
+            plateInfos.push_back(plateInfo);
+    }
+    if (plateInfos.size() > 0)
+        return plateInfos;
+    for (auto &plateInfo : GetSobelPlateInfos()) {
+        if (plateInfo.PlateCategory != PlateCategory_t::NonPlate)
+            plateInfos.push_back(plateInfo);
+    }
+    return plateInfos;
+}
+
+vector<PlateInfo>
+PlateLocatorPipeline::LocatePlatesSpeculative(ThreadPool &taskPool) {
+    if (matSource.empty())
+        return vector<PlateInfo>();
+    std::atomic<bool> colorFound{false};
+    // 颜色法和 Sobel 法由哪个线程领到不确定（任务池的线程可能先取走
+    // index 0），两者同时开始；只有颜色法已经完成并找到车牌时 Sobel 法才会
+    // 在下一个阶段跳过
+    taskPool.ParallelFor(2, [&](size_t index, size_t) {
+        if (index == 0) {
+            if (GetColorPlateCount() > 0)
+                colorFound = true;
+        } else {
+            SpeculateSobel(colorFound);
         }
+    });
+    // Sobel 法只有在颜色法成功时才会中途停止，此时不再需要它的结果
+    return LocatePlates();
+}
+
+void PlateLocatorPipeline::SpeculateSobel(const std::atomic<bool> &cancelled) {
+    if (cancelled)
+        return;
+    GetSobelThreshold();
+    if (cancelled)
+        return;
+    GetSobelErode();
+    if (cancelled)
+        return;
+    const vector<vector<Point>> &contours = GetSobelContours();
+    if (cancelled)
+        return;
+    vector<PlateInfo> plateInfos =
+        VerifyContours(contours, PlateLocateMethod_t::Sobel, &cancelled);
+    if (cancelled)
+        return;
+    sobelPlateInfos = plateInfos;
+    hasSobelPlateInfos = true;
+}
+
+const Mat &PlateLocatorPipeline::GetColorThreshold() {
+    if (!hasColorThreshold) {
+        StageTimer timer(PipelineStage_t::LocateColor);
+        // 蓝色 + 黄色的掩码，等同于 HSV 均衡化 V 后 inRange 相加再 Otsu
+        if (UseBands()) {
+            // 均衡化要用整幅图的直方图：各横条分别统计再相加
+            vector<cv::Range> bands = GetBands();
+            vector<vector<int>> histograms(bands.size(), vector<int>(256, 0));
+            taskPool->ParallelFor(bands.size(), [&](size_t index, size_t) {
+                PlateColorMask::AccumulateValueHistogram(
+                    matSource.rowRange(bands[index]), histograms[index].data());
+            });
+            int histogram[256] = {};
+            for (auto &bandHistogram : histograms) {
+                for (int i = 0; i < 256; i++) {
+                    histogram[i] += bandHistogram[i];
+                }
+            }
+            uchar lut[256];
+            PlateColorMask::BuildEqualizeLut(histogram, lut);
+            scratch.ColorThreshold.create(matSource.size(), CV_8UC1);
+            taskPool->ParallelFor(bands.size(), [&](size_t index, size_t) {
+                // 尺寸和类型相同，ComputeMask 直接写进整幅掩码的这几行
+                Mat bandMask = scratch.ColorThreshold.rowRange(bands[index]);
+                PlateColorMask::ComputeMask(matSource.rowRange(bands[index]),
+                                            lut, bandMask);
+            });
+        } else {
+            PlateColorMask::Compute(matSource, scratch.ColorThreshold);
+        }
+        if (!regionMask.empty())
+            cv::bitwise_and(scratch.ColorThreshold, regionMask,
+                            scratch.ColorThreshold);
+        hasColorThreshold = true;
     }
-    if (isPlateCount > 0) {
-        Mat rectImageForColor = matSource.clone();
-        reserveBoundingRects(rectImageForColor, contoursForColor, -1, {0, 0, 255});
-        return {{plateInfosForColor, thresholdForColor, threshold_ErodeForColor,
-                 contoursForColor, rectImageForColor}};
+    return scratch.ColorThreshold;
+}
+
+const Mat &PlateLocatorPipeline::GetColorErode() {
+    if (!hasColorErode) {
+        StageTimer timer(PipelineStage_t::LocateColor);
+        // TODO 腐蚀核大小
+        CloseAndErode(GetColorThreshold(), scratch.ColorClose,
+                      scratch.ColorErode, 3);
+        // 闭运算会把区域边上的块向外扩几个像素
+        if (!regionMask.empty())
+            cv::bitwise_and(scratch.ColorErode, regionMask, scratch.ColorErode);
+        hasColorErode = true;
     }
+    return scratch.ColorErode;
+}
 
-    vector<PlateInfo> plateInfosForSobel = vector<PlateInfo>();
-    cv::GaussianBlur(matSource, blur, cv::Size(blur_Size, blur_Size), 0, 0,
-                     cv::BorderTypes::BORDER_DEFAULT);
-    cv::cvtColor(blur, gray, cv::COLOR_BGR2GRAY);
-    // 对图像进⾏Sobel 运算，得到的是图像的⼀阶⽔平⽅向导数。
-    auto ddepth = CV_16S;
-    Mat grad_x;
-    cv::Sobel(gray, grad_x, ddepth, 1, 0, 3, sobel_Scale, sobel_Delta,
-              cv::BorderTypes::BORDER_DEFAULT);
-    Mat abs_grad_x;
-    cv::convertScaleAbs(grad_x, abs_grad_x);
-    Mat grad_y;
-    cv::Sobel(gray, grad_y, ddepth, 0, 1, 3, sobel_Scale, sobel_Delta,
-              cv::BorderTypes::BORDER_DEFAULT);
-    Mat abs_grad_y;
-    cv::convertScaleAbs(grad_y, abs_grad_y);
-    Mat grad = Mat();
-    cv::addWeighted(abs_grad_x, sobel_X_Weight, abs_grad_y, sobel_Y_Weight, 0,
-                    grad);
-    // 对图像进⾏⼆值化。将灰度图像（每个像素点有256
-    // 个取值可能）转化为⼆值图像（每个像素点仅有1 和0 两个取值可能）。
-    Mat thresholdForSobel;
-    cv::threshold(grad, thresholdForSobel, 0, 255,
-                  cv::ThresholdTypes::THRESH_OTSU |
-                      cv::ThresholdTypes::THRESH_BINARY);
-    // 使⽤闭操作。对图像进⾏闭操作以后，可以看到⻋牌区域被连接成⼀个矩形装的区域。
-    element = cv::getStructuringElement(
-        cv::MorphShapes::MORPH_RECT,
-        cv::Size(morph_Size_Width, morph_Size_Height));
-    cv::morphologyEx(thresholdForSobel, threshold_Close,
-                     cv::MorphTypes::MORPH_CLOSE, element);
-    element_Erode =
-        cv::getStructuringElement(cv::MorphShapes::MORPH_RECT, cv::Size(5, 5));
-
-    Mat threshold_CloseForSobel;
-    cv::erode(threshold_Close, threshold_CloseForSobel, element_Erode);
-    matProcess = threshold_CloseForSobel;
-
-    // Find 轮廓 of possibles plates
-    // 求轮廓。求出图中所有的轮廓。这个算法会把全图的轮廓都计算出来，
-    // 因此要进⾏ 筛选。
-    vector<vector<cv::Point>> contoursForClose = {};
-    hierarchys = {};
-    cv::findContours(threshold_CloseForSobel, contoursForClose, hierarchys,
-                     cv::RetrievalModes::RETR_EXTERNAL,
-                     cv::ContourApproximationModes::CHAIN_APPROX_NONE);
-    // 筛选。对轮廓求最⼩外接矩形，然后验证，不满⾜条件的淘汰。
-    for (size_t index = 0; index < contoursForClose.size(); index++) {
-        Rect rectROI = cv::boundingRect(contoursForClose[index]);
-        if (VerifyPlateSize(rectROI.size(), minWidth, maxWidth, minHeight,
-                            maxHeight, minRatio, maxRatio)) {
-            RotatedRect rotatedRect = cv::minAreaRect(contoursForClose[index]);
-            Mat matROI = matSource(rectROI);
-            PlateCategory_t plateCategory = PlateCategory_SVM::Test(matROI);
+const vector<vector<Point>> &PlateLocatorPipeline::GetColorContours() {
+    if (!hasColorContours) {
+        StageTimer timer(PipelineStage_t::LocateColor);
+        cv::findContours(GetColorErode(), scratch.ColorContours,
+                         scratch.ColorHierarchys,
+                         cv::RetrievalModes::RETR_EXTERNAL,
+                         cv::ContourApproximationModes::CHAIN_APPROX_NONE);
+        hasColorContours = true;
+    }
+    return scratch.ColorContours;
+}
 
-            PlateInfo plateInfo;
-            plateInfo.RotatedRect = rotatedRect;
-            plateInfo.OriginalRect = rectROI;
-            plateInfo.OriginalMat = matROI;
-            plateInfo.PlateCategory = plateCategory;
-            plateInfo.PlateLocateMethod = PlateLocateMethod_t::Sobel;
-            plateInfosForSobel.push_back(plateInfo);
+const vector<PlateInfo> &PlateLocatorPipeline::GetColorPlateInfos() {
+    if (!hasColorPlateInfos) {
+        colorPlateInfos =
+            VerifyContours(GetColorContours(), PlateLocateMethod_t::Color);
+        hasColorPlateInfos = true;
+    }
+    return colorPlateInfos;
+}
+
+size_t PlateLocatorPipeline::GetColorPlateCount() {
+    size_t isPlateCount = 0;
+    for (auto &plateInfo : GetColorPlateInfos()) {
+        if (plateInfo.PlateCategory != PlateCategory_t::NonPlate)
+            isPlateCount++;
+    }
+    return isPlateCount;
+}
+
+const Mat &PlateLocatorPipeline::GetSobelThreshold() {
+    if (!hasSobelThreshold) {
+        StageTimer timer(PipelineStage_t::LocateSobel);
+        // 模糊、灰度、Sobel 都只用到附近几行，和形态学一样可以分块计算
+        auto computeGrad = [this](const Mat &source, Mat &blur, Mat &gray,
+                                  Mat &grad_x, Mat &abs_grad_x, Mat &grad_y,
+                                  Mat &abs_grad_y, Mat &grad) {
+            cv::GaussianBlur(source, blur,
+                             cv::Size(config.BlurSize, config.BlurSize), 0, 0,
+                             cv::BorderTypes::BORDER_DEFAULT);
+            cv::cvtColor(blur, gray, cv::COLOR_BGR2GRAY);
+            // 对图像进⾏Sobel 运算，得到的是图像的⼀阶⽔平⽅向导数。
+            auto ddepth = CV_16S;
+            cv::Sobel(gray, grad_x, ddepth, 1, 0, 3, config.SobelScale,
+                      config.SobelDelta, cv::BorderTypes::BORDER_DEFAULT);
+            cv::convertScaleAbs(grad_x, abs_grad_x);
+            cv::Sobel(gray, grad_y, ddepth, 0, 1, 3, config.SobelScale,
+                      config.SobelDelta, cv::BorderTypes::BORDER_DEFAULT);
+            cv::convertScaleAbs(grad_y, abs_grad_y);
+            cv::addWeighted(abs_grad_x, config.SobelXWeight, abs_grad_y,
+                            config.SobelYWeight, 0, grad);
+        };
+        if (UseBands()) {
+            int halo = config.BlurSize / 2 + 2;
+            vector<cv::Range> bands = GetBands();
+            scratch.Grad.create(matSource.size(), CV_8UC1);
+            taskPool->ParallelFor(bands.size(), [&](size_t index, size_t) {
+                cv::Range band = bands[index];
+                int start = std::max(band.start - halo, 0);
+                int end = std::min(band.end + halo, matSource.rows);
+                Mat bandSource = matSource.rowRange(start, end).clone();
+                Mat blur, gray, grad_x, abs_grad_x, grad_y, abs_grad_y, grad;
+                computeGrad(bandSource, blur, gray, grad_x, abs_grad_x, grad_y,
+                            abs_grad_y, grad);
+                grad.rowRange(band.start - start, band.end - start)
+                    .copyTo(scratch.Grad.rowRange(band));
+            });
+        } else {
+            computeGrad(matSource, scratch.Blur, scratch.Gray, scratch.GradX,
+                        scratch.AbsGradX, scratch.GradY, scratch.AbsGradY,
+                        scratch.Grad);
         }
+        // 对图像进⾏⼆值化。将灰度图像（每个像素点有256
+        // 个取值可能）转化为⼆值图像（每个像素点仅有1 和0 两个取值可能）。
+        // Otsu 阈值取决于整幅图，分块时也在拼好的梯度图上计算
+        cv::threshold(scratch.Grad, scratch.SobelThreshold, 0, 255,
+                      cv::ThresholdTypes::THRESH_OTSU |
+                          cv::ThresholdTypes::THRESH_BINARY);
+        if (!regionMask.empty())
+            cv::bitwise_and(scratch.SobelThreshold, regionMask,
+                            scratch.SobelThreshold);
+        hasSobelThreshold = true;
     }
+    return scratch.SobelThreshold;
+}
 
-    Mat rectImageForColor = matSource.clone();
-    reserveBoundingRects(rectImageForColor, contoursForColor, -1, {0, 0, 255});
-    Mat rectImageForClose = matSource.clone();
-    reserveBoundingRects(rectImageForClose, contoursForClose, -1, {0, 0, 255});
-    return {{plateInfosForColor, thresholdForColor, threshold_ErodeForColor,
-             contoursForColor, rectImageForColor},
-            {plateInfosForSobel, thresholdForSobel, threshold_CloseForSobel,
-             contoursForClose, rectImageForClose}};
+const Mat &PlateLocatorPipeline::GetSobelErode() {
+    if (!hasSobelErode) {
+        StageTimer timer(PipelineStage_t::LocateSobel);
+        // 使⽤闭操作。对图像进⾏闭操作以后，可以看到⻋牌区域被连接成⼀个矩形装的区域。
+        CloseAndErode(GetSobelThreshold(), scratch.SobelClose,
+                      scratch.SobelErode, 5);
+        if (!regionMask.empty())
+            cv::bitwise_and(scratch.SobelErode, regionMask, scratch.SobelErode);
+        hasSobelErode = true;
+    }
+    return scratch.SobelErode;
 }
 
-vector<PlateInfo> PlateLocator_V3::LocatePlates(
-    const Mat &matSource, int blur_Size, int sobel_Scale, int sobel_Delta,
-    int sobel_X_Weight, int sobel_Y_Weight, int morph_Size_Width,
-    int morph_Size_Height, int minWidth, int maxWidth, int minHeight,
-    int maxHeight, float minRatio, float maxRatio) {
-    vector<PlateInfo> plateInfos = LocatePlatesByColor(
-        matSource, blur_Size, morph_Size_Width, morph_Size_Height, minWidth,
-        maxWidth, minHeight, maxHeight, minRatio, maxRatio);
-    if (plateInfos.size() > 0)
-        return plateInfos;
-    plateInfos = LocatePlatesBySobel(
-        matSource, blur_Size, sobel_Scale, sobel_Delta, sobel_X_Weight,
-        sobel_Y_Weight, morph_Size_Width, morph_Size_Height, minWidth, maxWidth,
-        minHeight, maxHeight, minRatio, maxRatio);
-    return plateInfos;
+const vector<vector<Point>> &PlateLocatorPipeline::GetSobelContours() {
+    if (!hasSobelContours) {
+        StageTimer timer(PipelineStage_t::LocateSobel);
+        // 求轮廓。求出图中所有的轮廓。这个算法会把全图的轮廓都计算出来，
+        // 因此要进⾏ 筛选。
+        cv::findContours(GetSobelErode(), scratch.SobelContours,
+                         scratch.SobelHierarchys,
+                         cv::RetrievalModes::RETR_EXTERNAL,
+                         cv::ContourApproximationModes::CHAIN_APPROX_NONE);
+        hasSobelContours = true;
+    }
+    return scratch.SobelContours;
 }
 
-vector<PlateInfo> PlateLocator_V3::LocatePlatesByColor(
-    const Mat &matSource, int blur_Size, int morph_Size_Width,
-    int morph_Size_Height, int minWidth, int maxWidth, int minHeight,
-    int maxHeight, float minRatio, float maxRatio) {
+const vector<PlateInfo> &PlateLocatorPipeline::GetSobelPlateInfos() {
+    if (!hasSobelPlateInfos) {
+        sobelPlateInfos =
+            VerifyContours(GetSobelContours(), PlateLocateMethod_t::Sobel);
+        hasSobelPlateInfos = true;
+    }
+    return sobelPlateInfos;
+}
+
+// 筛选。对轮廓求最⼩外接矩形，然后验证，不满⾜条件的淘汰。
+vector<PlateInfo> PlateLocatorPipeline::VerifyContours(
+    const vector<vector<Point>> &contours,
+    PlateLocateMethod_t plateLocateMethod,
+    const std::atomic<bool> *cancelled) const {
+    StageTimer timer(plateLocateMethod == PlateLocateMethod_t::Color
+                         ? PipelineStage_t::LocateColor
+                         : PipelineStage_t::LocateSobel);
     vector<PlateInfo> plateInfos = vector<PlateInfo>();
-    if (matSource.empty())
-        return plateInfos;
-    // Mat hsv = matSource.CvtColor(ColorConversionCodes.BGR2HSV);
-    Mat hsv;
-    cv::cvtColor(matSource, hsv, cv::COLOR_BGR2HSV);
-
-    // Mat[] hsvSplits = hsv.Split();
-    vector<Mat> hsvSplits;
-    cv::split(hsv, hsvSplits);
-    // hsvSplits[2] = hsvSplits[2].EqualizeHist();
-    cv::equalizeHist(hsvSplits[2], hsvSplits[2]);
-    Mat hsvEqualizeHist;
-    cv::merge(hsvSplits, hsvEqualizeHist);
-
-    Scalar blueStart = Scalar(100, 70, 70);
-    Scalar blueEnd = Scalar(140, 255, 255);
-    // Mat blue = hsvEqualizeHist.InRange(blueStart, blueEnd);
-    Mat blue;
-    cv::inRange(hsvEqualizeHist, blueStart, blueEnd, blue);
-
-    Scalar yellowStart = Scalar(15, 70, 70);
-    Scalar yellowEnd = Scalar(40, 255, 255);
-    // Mat yellow = hsvEqualizeHist.InRange(yellowStart, yellowEnd);
-    Mat yellow;
-    cv::inRange(hsvEqualizeHist, yellowStart, yellowEnd, yellow);
-    Mat add = blue + yellow;
-    // Mat threshold =
-    //     add.Threshold(0, 255, ThresholdTypes.Otsu |
-    //     ThresholdTypes.Binary);
-    Mat threshold;
-    cv::threshold(add, threshold, 0, 255,
-                  cv::ThresholdTypes::THRESH_OTSU |
-                      cv::ThresholdTypes::THRESH_BINARY);
-    Mat element = cv::getStructuringElement(
-        cv::MorphShapes::MORPH_RECT,
-        cv::Size(morph_Size_Width, morph_Size_Height));
-    // Mat threshold_Close = threshold.MorphologyEx(MorphTypes.Close,
-    // element);
-    Mat threshold_Close;
-    cv::morphologyEx(threshold, threshold_Close, cv::MorphTypes::MORPH_CLOSE,
-                     element);
-
-    // TODO 腐蚀核大小
-    Mat element_Erode =
-        cv::getStructuringElement(cv::MorphShapes::MORPH_RECT, cv::Size(3, 3));
-    // Mat element_Erode = cv::getStructuringElement(
-    //     cv::MorphShapes::MORPH_RECT, cv::Size(10, 10));
-    // Mat threshold_Erode = threshold_Close.Erode(element_Erode);
-    Mat threshold_Erode;
-    cv::erode(threshold_Close, threshold_Erode, element_Erode);
-
-    vector<vector<cv::Point>> contours = {};
-    vector<cv::Vec4i> hierarchys = {};
-    cv::findContours(threshold_Erode, contours, hierarchys,
-                     cv::RetrievalModes::RETR_EXTERNAL,
-                     cv::ContourApproximationModes::CHAIN_APPROX_NONE);
     for (size_t index = 0; index < contours.size(); index++) {
         Rect rectROI = cv::boundingRect(contours[index]);
-        if (VerifyPlateSize(rectROI.size(), minWidth, maxWidth, minHeight,
-                            maxHeight, minRatio, maxRatio)) {
-            Mat matROI = matSource(rectROI);
-            PlateCategory_t plateCategory = PlateCategory_SVM::Test(matROI);
-            if (plateCategory == PlateCategory_t::NonPlate)
-                continue;
-            PlateInfo plateInfo = PlateInfo();
+        if (PlateLocator_V3::VerifyPlateSize(
+                rectROI.size(), config.MinWidth, config.MaxWidth,
+                config.MinHeight, config.MaxHeight, config.MinRatio,
+                config.MaxRatio)) {
+            PlateInfo plateInfo;
+            plateInfo.RotatedRect = cv::minAreaRect(contours[index]);
             plateInfo.OriginalRect = rectROI;
-            plateInfo.OriginalMat = matROI;
-            plateInfo.PlateCategory = plateCategory;
-            plateInfo.PlateLocateMethod = PlateLocateMethod_t::Sobel;
+            plateInfo.OriginalMat = matSource(rectROI);
+            plateInfo.PlateLocateMethod = plateLocateMethod;
             plateInfos.push_back(plateInfo);
         }
     }
+
+    // 分类器是 const 的，候选较多的大图上各候选可以并行分类
+    auto classify = [&](size_t index, size_t) {
+        if (cancelled != nullptr && *cancelled)
+            return;
+        StageTimer timer(PipelineStage_t::CategorySVM);
+        plateInfos[index].PlateCategory =
+            plateCategorySVM.Test(plateInfos[index].OriginalMat);
+    };
+    if (UseBands()) {
+        taskPool->ParallelFor(plateInfos.size(), classify);
+    } else {
+        for (size_t index = 0; index < plateInfos.size(); index++) {
+            classify(index, 0);
+        }
+    }
     return plateInfos;
 }
 
-vector<PlateInfo> PlateLocator_V3::LocatePlatesBySobel(
-    Mat matSource, int blur_Size, int sobel_Scale, int sobel_Delta,
+PlateLocatorConfig PlateLocator_V3::MakeConfig(
+    int blur_Size, int sobel_Scale, int sobel_Delta, int sobel_X_Weight,
+    int sobel_Y_Weight, int morph_Size_Width, int morph_Size_Height,
+    int minWidth, int maxWidth, int minHeight, int maxHeight, float minRatio,
+    float maxRatio) {
+    PlateLocatorConfig config;
+    config.BlurSize = blur_Size;
+    config.SobelScale = sobel_Scale;
+    config.SobelDelta = sobel_Delta;
+    config.SobelXWeight = sobel_X_Weight;
+    config.SobelYWeight = sobel_Y_Weight;
+    config.MorphSizeWidth = morph_Size_Width;
+    config.MorphSizeHeight = morph_Size_Height;
+    config.MinWidth = minWidth;
+    config.MaxWidth = maxWidth;
+    config.MinHeight = minHeight;
+    config.MaxHeight = maxHeight;
+    config.MinRatio = minRatio;
+    config.MaxRatio = maxRatio;
+    return config;
+}
+
+vector<PlateInfo> PlateLocator_V3::LocatePlatesForCameraAdjust(
+    const PlateCategory_SVM &plateCategorySVM, const Mat &matSource,
+    Mat &matProcess, int blur_Size, int sobel_Scale, int sobel_Delta,
     int sobel_X_Weight, int sobel_Y_Weight, int morph_Size_Width,
     int morph_Size_Height, int minWidth, int maxWidth, int minHeight,
     int maxHeight, float minRatio, float maxRatio) {
-    vector<PlateInfo> plateInfos = vector<PlateInfo>();
-    if (matSource.empty())
-        return plateInfos;
-    Mat blur;
-    Mat gray;
-    // blur =
-    //     matSource.GaussianBlur(cv::Size(blur_Size, blur_Size),
-    //                            0, 0, BorderTypes.Default);
-    cv::GaussianBlur(matSource, blur, cv::Size(blur_Size, blur_Size), 0, 0,
-                     cv::BorderTypes::BORDER_DEFAULT);
-    // gray = blur.CvtColor(ColorConversionCodes.BGR2GRAY);
-    cv::cvtColor(blur, gray, cv::COLOR_BGR2GRAY);
-    // 对图像进⾏Sobel 运算，得到的是图像的⼀阶⽔平⽅向导数。
-    // Generate grad_x and grad_y
-    auto ddepth = CV_16S;
-    // Mat grad_x = gray.Sobel(ddepth, 1, 0, 3, sobel_Scale, sobel_Delta,
-    //                         BorderTypes.Default);
-    Mat grad_x;
-    cv::Sobel(gray, grad_x, ddepth, 1, 0, 3, sobel_Scale, sobel_Delta,
-              cv::BorderTypes::BORDER_DEFAULT);
-    // Mat abs_grad_x = grad_x.ConvertScaleAbs();
-    Mat abs_grad_x;
-    cv::convertScaleAbs(grad_x, abs_grad_x);
-    // Mat grad_y = gray.Sobel(ddepth, 0, 1, 3, sobel_Scale, sobel_Delta,
-    //                         BorderTypes.Default);
-    Mat grad_y;
-    cv::Sobel(gray, grad_y, ddepth, 0, 1, 3, sobel_Scale, sobel_Delta,
-              cv::BorderTypes::BORDER_DEFAULT);
-    // Mat abs_grad_y = grad_y.ConvertScaleAbs();
-    Mat abs_grad_y;
-    cv::convertScaleAbs(grad_y, abs_grad_y);
-    Mat grad;
-    cv::addWeighted(abs_grad_x, sobel_X_Weight, abs_grad_y, sobel_Y_Weight, 0,
-                    grad);
-
-    // 对图像进⾏⼆值化。将灰度图像（每个像素点有256
-    // 个取值可能）转化为⼆值图像（每个像素点仅有1 和0 两个取值可能）。
-    // Mat threshold =
-    //     grad.Threshold(0, 255, ThresholdTypes.Otsu |
-    //     ThresholdTypes.Binary);
-    Mat threshold;
-    cv::threshold(grad, threshold, 0, 255,
-                  cv::ThresholdTypes::THRESH_OTSU |
-                      cv::ThresholdTypes::THRESH_BINARY);
-
-    // 使⽤闭操作。对图像进⾏闭操作以后，可以看到⻋牌区域被连接成⼀个矩形装的区域。
-    Mat element = cv::getStructuringElement(
-        cv::MorphShapes::MORPH_RECT,
-        cv::Size(morph_Size_Width, morph_Size_Height));
-    // Mat threshold_Close = threshold.MorphologyEx(MorphTypes.Close,
-    // element);
-    Mat threshold_Close;
-    cv::morphologyEx(threshold, threshold_Close, cv::MorphTypes::MORPH_CLOSE,
-                     element);
-
-    Mat element_Erode =
-        cv::getStructuringElement(cv::MorphShapes::MORPH_RECT, cv::Size(5, 5));
-    // Mat threshold_Erode = threshold_Close.Erode(element_Erode);
-    Mat threshold_Erode;
-    cv::erode(threshold_Close, threshold_Erode, element_Erode);
-    // Find 轮廓 of possibles plates
-    // 求轮廓。求出图中所有的轮廓。这个算法会把全图的轮廓都计算出来，
-    // 因此要进⾏ 筛选。
-    vector<vector<cv::Point>> contours = {};
-    vector<cv::Vec4i> hierarchys = {};
-    cv::findContours(threshold_Erode, contours, hierarchys,
-                     cv::RetrievalModes::RETR_EXTERNAL,
-                     cv::ContourApproximationModes::CHAIN_APPROX_NONE);
-    // 筛选。对轮廓求最⼩外接矩形，然后验证，不满⾜条件的淘汰。
-    for (size_t index = 0; index < contours.size(); index++) {
-        Rect rectROI = cv::boundingRect(contours[index]);
-        if (VerifyPlateSize(rectROI.size(), minWidth, maxWidth, minHeight,
-                            maxHeight, minRatio, maxRatio)) {
-            Mat matROI = matSource(rectROI);
-            PlateCategory_t plateCategory = PlateCategory_SVM::Test(matROI);
-            if (plateCategory == PlateCategory_t::NonPlate)
-                continue;
-            PlateInfo plateInfo = PlateInfo();
-            plateInfo.OriginalRect = rectROI;
-            plateInfo.OriginalMat = matROI;
-            plateInfo.PlateCategory = plateCategory;
-            plateInfo.PlateLocateMethod = PlateLocateMethod_t::Sobel;
+    if (matSource.empty()) {
+        matProcess = Mat(0, 0, CV_8UC1);
+        return {};
+    }
+    PlateLocatorPipeline pipeline(
+        plateCategorySVM,
+        MakeConfig(blur_Size, sobel_Scale, sobel_Delta, sobel_X_Weight,
+                   sobel_Y_Weight, morph_Size_Width, morph_Size_Height,
+                   minWidth, maxWidth, minHeight, maxHeight, minRatio,
+                   maxRatio));
+    pipeline.SetSource(matSource);
+    // 只返回颜色法的结果，颜色法没有找到车牌时显示 Sobel 法的中间结果
+    if (pipeline.GetColorPlateCount() > 0)
+        matProcess = pipeline.GetColorErode();
+    else
+        matProcess = pipeline.GetSobelErode();
+    vector<PlateInfo> plateInfos;
+    for (auto &plateInfo : pipeline.GetColorPlateInfos()) {
+        if (plateInfo.PlateCategory != PlateCategory_t::NonPlate)
             plateInfos.push_back(plateInfo);
+    }
+    return plateInfos;
+}
+
+// color:  PlateInfos, threshold, after erode and close, contours, rected
+// sobel(optional): PlateInfos, threshold, after erode and close, contours, rected
+vector<tuple<vector<PlateInfo>, Mat, Mat, vector<vector<Point>>, Mat>>
+PlateLocator_V3::LocatePlatesForAutoSample(
+    const PlateCategory_SVM &plateCategorySVM, const Mat &matSource,
+    Mat &matProcess, int blur_Size, int sobel_Scale, int sobel_Delta,
+    int sobel_X_Weight, int sobel_Y_Weight, int morph_Size_Width,
+    int morph_Size_Height, int minWidth, int maxWidth, int minHeight,
+    int maxHeight, float minRatio, float maxRatio) {
+    if (matSource.empty() || matSource.rows == 0 || matSource.cols == 0) {
+        matProcess = Mat(0, 0, CV_8UC1);
+        return {{}, {}, {}, {}, {}};
+    }
+    // pipeline 在函数结束时销毁，返回的 Mat 仍然持有各自的数据
+    PlateLocatorPipeline pipeline(
+        plateCategorySVM,
+        MakeConfig(blur_Size, sobel_Scale, sobel_Delta, sobel_X_Weight,
+                   sobel_Y_Weight, morph_Size_Width, morph_Size_Height,
+                   minWidth, maxWidth, minHeight, maxHeight, minRatio,
+                   maxRatio));
+    pipeline.SetSource(matSource);
+
+    Mat rectImageForColor = matSource.clone();
+    reserveBoundingRects(rectImageForColor, pipeline.GetColorContours(), -1,
+                         {0, 0, 255});
+    auto colorResult = tuple<vector<PlateInfo>, Mat, Mat,
+                             vector<vector<Point>>, Mat>{
+        pipeline.GetColorPlateInfos(), pipeline.GetColorThreshold(),
+        pipeline.GetColorErode(), pipeline.GetColorContours(),
+        rectImageForColor};
+    if (pipeline.GetColorPlateCount() > 0) {
+        matProcess = pipeline.GetColorErode();
+        return {colorResult};
+    }
+
+    matProcess = pipeline.GetSobelErode();
+    Mat rectImageForSobel = matSource.clone();
+    reserveBoundingRects(rectImageForSobel, pipeline.GetSobelContours(), -1,
+                         {0, 0, 255});
+    return {colorResult,
+            {pipeline.GetSobelPlateInfos(), pipeline.GetSobelThreshold(),
+             pipeline.GetSobelErode(), pipeline.GetSobelContours(),
+             rectImageForSobel}};
+}
+
+vector<PlateInfo> PlateLocator_V3::LocatePlates(
+    const PlateCategory_SVM &plateCategorySVM, const Mat &matSource,
+    int blur_Size, int sobel_Scale, int sobel_Delta, int sobel_X_Weight,
+    int sobel_Y_Weight, int morph_Size_Width, int morph_Size_Height,
+    int minWidth, int maxWidth, int minHeight, int maxHeight, float minRatio,
+    float maxRatio) {
+    return LocatePlates(
+        plateCategorySVM, matSource,
+        MakeConfig(blur_Size, sobel_Scale, sobel_Delta, sobel_X_Weight,
+                   sobel_Y_Weight, morph_Size_Width, morph_Size_Height,
+                   minWidth, maxWidth, minHeight, maxHeight, minRatio,
+                   maxRatio));
+}
+
+vector<PlateInfo>
+PlateLocator_V3::LocatePlates(const PlateCategory_SVM &plateCategorySVM,
+                              const Mat &matSource,
+                              const PlateLocatorConfig &config) {
+    PlateLocatorScratch scratch;
+    return LocatePlates(plateCategorySVM, matSource, config, scratch);
+}
+
+vector<PlateInfo>
+PlateLocator_V3::LocatePlates(const PlateCategory_SVM &plateCategorySVM,
+                              const Mat &matSource,
+                              const PlateLocatorConfig &config,
+                              PlateLocatorScratch &scratch,
+                              ThreadPool *taskPool) {
+    if (matSource.empty())
+        return vector<PlateInfo>();
+    // 只处理摄像头关心的区域，最后再换算回整幅图的坐标
+    Rect region = GetRegion(config, matSource.size(), scratch.RegionMask);
+    if (region.area() == 0)
+        return vector<PlateInfo>();
+    Mat matRegion = matSource(region);
+
+    vector<PlateInfo> plateInfos;
+    if (config.PyramidScale > 1) {
+        plateInfos =
+            LocatePlatesCoarseToFine(plateCategorySVM, matRegion,
+                                     scratch.RegionMask, config, scratch,
+                                     taskPool);
+    } else {
+        // 生产路径只取 PlateInfo，不生成 AutoSample 用来显示的图
+        PlateLocatorPipeline pipeline(plateCategorySVM, config, scratch);
+        pipeline.SetSource(matRegion, scratch.RegionMask);
+        pipeline.SetTaskPool(taskPool);
+        if (taskPool != nullptr && config.SpeculativeSobel)
+            plateInfos = pipeline.LocatePlatesSpeculative(*taskPool);
+        else
+            plateInfos = pipeline.LocatePlates();
+    }
+    for (auto &plateInfo : plateInfos) {
+        plateInfo.OriginalRect += region.tl();
+        plateInfo.RotatedRect.center +=
+            cv::Point2f((float)region.x, (float)region.y);
+    }
+    return plateInfos;
+}
+
+Rect PlateLocator_V3::GetRegion(const PlateLocatorConfig &config,
+                                const cv::Size &sourceSize, Mat &regionMask) {
+    Rect region(cv::Point(0, 0), sourceSize);
+    if (config.RegionOfInterest.area() > 0)
+        region &= config.RegionOfInterest;
+    if (config.RegionPolygon.empty()) {
+        regionMask.release();
+        return region;
+    }
+    region &= cv::boundingRect(config.RegionPolygon);
+    if (region.area() == 0) {
+        regionMask.release();
+        return region;
+    }
+    regionMask.create(region.size(), CV_8UC1);
+    regionMask.setTo(0);
+    vector<vector<Point>> polygons = {config.RegionPolygon};
+    cv::fillPoly(regionMask, polygons, Scalar(255), cv::LINE_8, 0,
+                 -region.tl());
+    return region;
+}
+
+vector<PlateInfo> PlateLocator_V3::LocatePlatesCoarseToFine(
+    const PlateCategory_SVM &plateCategorySVM, const Mat &matSource,
+    const Mat &regionMask, const PlateLocatorConfig &config,
+    PlateLocatorScratch &scratch, ThreadPool *taskPool) {
+    int scale = config.PyramidScale;
+    PlateLocatorConfig coarseConfig = ScaleConfig(config, scale);
+    cv::resize(matSource, scratch.Small, cv::Size(), 1.0 / scale, 1.0 / scale,
+               cv::InterpolationFlags::INTER_AREA);
+    PlateLocatorPipeline coarse(plateCategorySVM, coarseConfig, scratch);
+    if (regionMask.empty()) {
+        scratch.SmallRegionMask.release();
+    } else {
+        cv::resize(regionMask, scratch.SmallRegionMask, scratch.Small.size(),
+                   0, 0, cv::InterpolationFlags::INTER_NEAREST);
+    }
+    coarse.SetSource(scratch.Small, scratch.SmallRegionMask);
+    coarse.SetTaskPool(taskPool);
+    if (scratch.Fine == nullptr)
+        scratch.Fine = std::make_shared<PlateLocatorScratch>();
+    PlateLocatorPipeline fine(plateCategorySVM, config, *scratch.Fine);
+    fine.SetTaskPool(taskPool);
+
+    // method 0 为颜色法，1 为 Sobel 法，找到的车牌加到 plateInfos
+    vector<PlateInfo> plateInfos = vector<PlateInfo>();
+    auto locateByMethod = [&](int method) {
+        const vector<vector<Point>> &contours =
+            method == 0 ? coarse.GetColorContours() : coarse.GetSobelContours();
+        vector<Rect> regions = GetCoarseRegions(contours, config, coarseConfig,
+                                                scale, matSource.size());
+        for (auto &region : regions) {
+            fine.SetSource(matSource(region), regionMask.empty()
+                                                  ? Mat()
+                                                  : regionMask(region));
+            const vector<PlateInfo> &candidates =
+                method == 0 ? fine.GetColorPlateInfos()
+                            : fine.GetSobelPlateInfos();
+            for (auto plateInfo : candidates) {
+                if (plateInfo.PlateCategory == PlateCategory_t::NonPlate)
+                    continue;
+                // 换算回原图坐标，OriginalMat 本来就是原图的一部分
+                plateInfo.OriginalRect += region.tl();
+                plateInfo.RotatedRect.center +=
+                    cv::Point2f((float)region.x, (float)region.y);
+                plateInfos.push_back(plateInfo);
+            }
         }
+    };
+
+    // 与 LocatePlates 相同：颜色法的区域里没有找到车牌时再用 Sobel 法的区域。
+    // SpeculativeSobel 时缩小图上的 Sobel 轮廓与颜色法同时计算，颜色法找到
+    // 车牌后在下一个阶段停止；原图上的 Sobel 法仍然只在颜色法失败后进行
+    if (taskPool != nullptr && config.SpeculativeSobel) {
+        std::atomic<bool> colorFound{false};
+        taskPool->ParallelFor(2, [&](size_t index, size_t) {
+            if (index == 0) {
+                locateByMethod(0);
+                if (!plateInfos.empty())
+                    colorFound = true;
+                return;
+            }
+            if (colorFound)
+                return;
+            coarse.GetSobelThreshold();
+            if (colorFound)
+                return;
+            coarse.GetSobelErode();
+            if (colorFound)
+                return;
+            coarse.GetSobelContours();
+        });
+    } else {
+        locateByMethod(0);
     }
+    if (plateInfos.empty())
+        locateByMethod(1);
     return plateInfos;
 }
+
+PlateLocatorConfig PlateLocator_V3::ScaleConfig(const PlateLocatorConfig &config,
+                                                int scale) {
+    PlateLocatorConfig coarseConfig = config;
+    // GaussianBlur 的核必须是奇数
+    coarseConfig.BlurSize = std::max(1, config.BlurSize / scale) | 1;
+    coarseConfig.MorphSizeWidth = std::max(1, config.MorphSizeWidth / scale);
+    coarseConfig.MorphSizeHeight = std::max(1, config.MorphSizeHeight / scale);
+    coarseConfig.MinWidth = config.MinWidth * 4 / (5 * scale);
+    coarseConfig.MaxWidth = config.MaxWidth * 6 / (5 * scale) + 1;
+    coarseConfig.MinHeight = config.MinHeight * 4 / (5 * scale);
+    coarseConfig.MaxHeight = config.MaxHeight * 6 / (5 * scale) + 1;
+    coarseConfig.MinRatio = config.MinRatio * 0.8f;
+    coarseConfig.MaxRatio = config.MaxRatio * 1.2f;
+    coarseConfig.PyramidScale = 1;
+    return coarseConfig;
+}
+
+vector<Rect> PlateLocator_V3::GetCoarseRegions(
+    const vector<vector<Point>> &contours, const PlateLocatorConfig &config,
+    const PlateLocatorConfig &coarseConfig, int scale,
+    const cv::Size &sourceSize) {
+    vector<Rect> regions;
+    Rect sourceRect(cv::Point(0, 0), sourceSize);
+    for (auto &contour : contours) {
+        Rect rect = cv::boundingRect(contour);
+        if (!VerifyPlateSize(rect.size(), coarseConfig.MinWidth,
+                             coarseConfig.MaxWidth, coarseConfig.MinHeight,
+                             coarseConfig.MaxHeight, coarseConfig.MinRatio,
+                             coarseConfig.MaxRatio))
+            continue;
+        Rect region(rect.x * scale, rect.y * scale, rect.width * scale,
+                    rect.height * scale);
+        // 留出形态学运算需要的边缘，同时容纳缩小时损失的精度
+        int marginX = region.width / 4 + config.MorphSizeWidth + scale;
+        int marginY = region.height / 2 + config.MorphSizeHeight + scale;
+        region -= cv::Point(marginX, marginY);
+        region += cv::Size(2 * marginX, 2 * marginY);
+        region &= sourceRect;
+        if (region.area() > 0)
+            regions.push_back(region);
+    }
+
+    // 合并有重叠的区域，同一块车牌不会被定位两次。合并后区域变大，可能又和
+    // 前面的区域重叠，所以一直重复到没有可合并的为止
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < regions.size(); i++) {
+            for (size_t j = i + 1; j < regions.size();) {
+                if ((regions[i] & regions[j]).area() > 0) {
+                    regions[i] |= regions[j];
+                    regions.erase(regions.begin() + j);
+                    merged = true;
+                } else {
+                    j++;
+                }
+            }
+        }
+    }
+    return regions;
+}
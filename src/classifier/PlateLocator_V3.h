@@ -14,6 +14,8 @@ using cv::RotatedRect;
 using cv::Scalar;
 using cv::split;
 
+#include <atomic>
+#include <memory>
 #include <vector>
 using std::vector;
 #include <string>
@@ -21,11 +23,14 @@ using std::string;
 #include <utility>
 using std::tuple;
 
+#include "CharInfo.h"
+
 /*--------  Forward declarations  --------*/
 namespace Doit {
 namespace CV {
 namespace PlateRecogn {
-class PlateInfo;
+class PlateCategory_SVM;
+class ThreadPool;
 } // namespace PlateRecogn
 } // namespace CV
 } // namespace Doit
@@ -33,6 +38,156 @@ class PlateInfo;
 namespace Doit {
 namespace CV {
 namespace PlateRecogn {
+// 定位参数，默认值与 LocatePlates 的默认参数一致
+struct PlateLocatorConfig {
+    int BlurSize = 5;
+    int SobelScale = 1;
+    int SobelDelta = 0;
+    int SobelXWeight = 1;
+    int SobelYWeight = 0;
+    int MorphSizeWidth = 17;
+    int MorphSizeHeight = 3;
+    int MinWidth = 60;
+    int MaxWidth = 180;
+    int MinHeight = 18;
+    int MaxHeight = 80;
+    float MinRatio = 0.15f;
+    float MaxRatio = 0.70f;
+    // 有 TaskPool 时 Sobel 法和颜色法同时开始，颜色法找到车牌就放弃 Sobel 法，
+    // 颜色法失败的帧耗时约为 max(颜色法, Sobel 法)
+    bool SpeculativeSobel = false;
+    // 大于 1 时先在缩小 PyramidScale 倍的图上找候选区域（形态学核和尺寸限制
+    // 同样缩小），再在原图上只对这些区域做完整的定位。颜色掩码的均衡化只统计
+    // 区域内的像素，所以结果和全图定位可能略有不同。此时 SpeculativeSobel
+    // 只推测计算缩小图上的 Sobel 轮廓，BandCount 对缩小图和各个区域分别生效
+    int PyramidScale = 1;
+    // 大于 1 且有 TaskPool 时把图像分成 BandCount 个横条并行计算掩码和形态学，
+    // 每个横条多算上下相邻的几行，拼起来和不分块的结果完全一样
+    int BandCount = 1;
+    // 每个摄像头关心的区域，结果仍然是整幅图的坐标。RegionOfInterest 为空
+    // 时表示整幅图；RegionPolygon 不为空时只保留多边形内的掩码（车道区域）。
+    // 均衡化直方图和 Otsu 阈值统计的是区域的外接矩形
+    Rect RegionOfInterest;
+    vector<Point> RegionPolygon;
+};
+
+// 定位过程中的中间图像和轮廓。同一个 scratch 在多次调用之间复用，尺寸不变时
+// 不再重新分配内存；一个 scratch 同一时间只能给一个线程用
+struct PlateLocatorScratch {
+    // 颜色法
+    Mat ColorThreshold;
+    Mat ColorClose;
+    Mat ColorErode;
+    vector<vector<Point>> ColorContours;
+    vector<cv::Vec4i> ColorHierarchys;
+    // Sobel 法
+    Mat Blur;
+    Mat Gray;
+    Mat GradX;
+    Mat AbsGradX;
+    Mat GradY;
+    Mat AbsGradY;
+    Mat Grad;
+    Mat SobelThreshold;
+    Mat SobelClose;
+    Mat SobelErode;
+    vector<vector<Point>> SobelContours;
+    vector<cv::Vec4i> SobelHierarchys;
+    // RegionPolygon 在 RegionOfInterest 内的掩码
+    Mat RegionMask;
+    // PyramidScale > 1 时：缩小后的图和掩码，以及原图上逐个区域定位用的 scratch
+    Mat Small;
+    Mat SmallRegionMask;
+    std::shared_ptr<PlateLocatorScratch> Fine;
+};
+
+/**
+ * 一帧图像的定位流程。每个中间结果第一次被用到时才计算，同一帧内只计算一次，
+ * 所以 LocatePlates 和 LocatePlatesForAutoSample 可以共用同一套代码：
+ * 前者只取最后的 PlateInfo，后者再取出阈值图、形态学结果和轮廓来显示。
+ *
+ * 中间结果保存在 scratch 里，SetSource 换一帧之后继续复用这些缓冲区。
+ * 返回的 Mat 引用 scratch 的数据，下一帧会被覆盖，需要保留时先 clone。
+ */
+class PlateLocatorPipeline {
+  public:
+    PlateLocatorPipeline(const PlateCategory_SVM &plateCategorySVM,
+                         const PlateLocatorConfig &config);
+    PlateLocatorPipeline(const PlateCategory_SVM &plateCategorySVM,
+                         const PlateLocatorConfig &config,
+                         PlateLocatorScratch &scratch);
+
+    PlateLocatorPipeline(const PlateLocatorPipeline &) = delete;
+    PlateLocatorPipeline &operator=(const PlateLocatorPipeline &) = delete;
+
+    // 换一帧图像，之前的中间结果全部作废。regionMask 不为空时（CV_8UC1，
+    // 与 matSource 同尺寸）阈值图和形态学结果只保留非零的部分
+    void SetSource(const Mat &matSource, const Mat &regionMask = Mat());
+
+    // 设置后 config.BandCount > 1 时分块并行计算，为空时全部在调用线程上计算
+    void SetTaskPool(ThreadPool *taskPool);
+
+    // 优先使用颜色法，颜色法没有找到车牌时再用 Sobel 法，NonPlate 已去掉
+    vector<PlateInfo> LocatePlates();
+
+    // 结果与 LocatePlates() 相同。颜色法和 Sobel 法在 taskPool 的两个线程
+    // （其中一个可能是调用线程）上同时计算，颜色法成功后 Sobel 法在下一个
+    // 阶段停止。
+    // 颜色法和 Sobel 法的中间结果互不共享，两个线程不会写同一块数据
+    vector<PlateInfo> LocatePlatesSpeculative(ThreadPool &taskPool);
+
+  public:
+    // 颜色法：蓝黄掩码、闭运算再腐蚀的结果、外轮廓
+    const Mat &GetColorThreshold();
+    const Mat &GetColorErode();
+    const vector<vector<Point>> &GetColorContours();
+    // 尺寸符合的候选，包括分类为 NonPlate 的
+    const vector<PlateInfo> &GetColorPlateInfos();
+    // 分类结果不是 NonPlate 的个数
+    size_t GetColorPlateCount();
+
+    // Sobel 法：梯度的阈值图、闭运算再腐蚀的结果、外轮廓
+    const Mat &GetSobelThreshold();
+    const Mat &GetSobelErode();
+    const vector<vector<Point>> &GetSobelContours();
+    const vector<PlateInfo> &GetSobelPlateInfos();
+
+  private:
+    vector<PlateInfo>
+    VerifyContours(const vector<vector<Point>> &contours,
+                   PlateLocateMethod_t plateLocateMethod,
+                   const std::atomic<bool> *cancelled = nullptr) const;
+
+    void SpeculateSobel(const std::atomic<bool> &cancelled);
+
+    bool UseBands() const;
+    // 把 [0, rows) 平均分成 config.BandCount 段
+    vector<cv::Range> GetBands() const;
+    // 闭运算后再用 erodeSize x erodeSize 的核腐蚀
+    void CloseAndErode(const Mat &threshold, Mat &close, Mat &erode,
+                       int erodeSize) const;
+
+    const PlateCategory_SVM &plateCategorySVM;
+    PlateLocatorConfig config;
+    PlateLocatorScratch ownedScratch;
+    PlateLocatorScratch &scratch;
+    ThreadPool *taskPool = nullptr;
+
+    Mat matSource;
+    Mat regionMask;
+    bool hasColorThreshold = false;
+    bool hasColorErode = false;
+    bool hasColorContours = false;
+    bool hasColorPlateInfos = false;
+    bool hasSobelThreshold = false;
+    bool hasSobelErode = false;
+    bool hasSobelContours = false;
+    bool hasSobelPlateInfos = false;
+    vector<PlateInfo> colorPlateInfos;
+    vector<PlateInfo> sobelPlateInfos;
+};
+
+// 所有函数都不修改共享状态，车牌类型分类器由调用者传入，可以多线程同时调用
 class PlateLocator_V3 {
   public:
     static bool VerifyPlateSize(const cv::Size &size, int minWidth = 60,
@@ -42,19 +197,20 @@ class PlateLocator_V3 {
 
   public:
     static vector<PlateInfo> LocatePlatesForCameraAdjust(
-        const Mat &matSource, Mat &matProcess, int blur_Size = 5,
-        int sobel_Scale = 1, int sobel_Delta = 0, int sobel_X_Weight = 1,
-        int sobel_Y_Weight = 0, int morph_Size_Width = 17,
-        int morph_Size_Height = 3, int minWidth = 60, int maxWidth = 250,
-        int minHeight = 18, int maxHeight = 100, float minRatio = 0.15f,
-        float maxRatio = 0.70f);
+        const PlateCategory_SVM &plateCategorySVM, const Mat &matSource,
+        Mat &matProcess, int blur_Size = 5, int sobel_Scale = 1,
+        int sobel_Delta = 0, int sobel_X_Weight = 1, int sobel_Y_Weight = 0,
+        int morph_Size_Width = 17, int morph_Size_Height = 3,
+        int minWidth = 60, int maxWidth = 250, int minHeight = 18,
+        int maxHeight = 100, float minRatio = 0.15f, float maxRatio = 0.70f);
 
   public:
     // color:  PlateInfos, threshold, after erode and close, contours, rected
     // sobel(optional): PlateInfos, threshold, after erode and close, contours, rected
     static vector<
         tuple<vector<PlateInfo>, Mat, Mat, vector<vector<Point>>, Mat>>
-    LocatePlatesForAutoSample(const Mat &matSource, Mat &matProcess,
+    LocatePlatesForAutoSample(const PlateCategory_SVM &plateCategorySVM,
+                              const Mat &matSource, Mat &matProcess,
                               int blur_Size = 5, int sobel_Scale = 1,
                               int sobel_Delta = 0, int sobel_X_Weight = 1,
                               int sobel_Y_Weight = 0, int morph_Size_Width = 17,
@@ -65,28 +221,53 @@ class PlateLocator_V3 {
 
   public:
     static vector<PlateInfo>
-    LocatePlates(const Mat &matSource, int blur_Size = 5, int sobel_Scale = 1,
+    LocatePlates(const PlateCategory_SVM &plateCategorySVM,
+                 const Mat &matSource, int blur_Size = 5, int sobel_Scale = 1,
                  int sobel_Delta = 0, int sobel_X_Weight = 1,
                  int sobel_Y_Weight = 0, int morph_Size_Width = 17,
                  int morph_Size_Height = 3, int minWidth = 60,
                  int maxWidth = 180, int minHeight = 18, int maxHeight = 80,
                  float minRatio = 0.15f, float maxRatio = 0.70f);
 
-  private:
     static vector<PlateInfo>
-    LocatePlatesByColor(const Mat &matSource, int blur_Size = 5,
-                        int morph_Size_Width = 17, int morph_Size_Height = 3,
-                        int minWidth = 60, int maxWidth = 180,
-                        int minHeight = 18, int maxHeight = 80,
-                        float minRatio = 0.15f, float maxRatio = 0.70f);
+    LocatePlates(const PlateCategory_SVM &plateCategorySVM,
+                 const Mat &matSource, const PlateLocatorConfig &config);
+
+    // taskPool 不为空并且 config.SpeculativeSobel 时使用推测执行的 Sobel 法
+    static vector<PlateInfo>
+    LocatePlates(const PlateCategory_SVM &plateCategorySVM,
+                 const Mat &matSource, const PlateLocatorConfig &config,
+                 PlateLocatorScratch &scratch, ThreadPool *taskPool = nullptr);
 
   private:
-    static vector<PlateInfo> LocatePlatesBySobel(
-        Mat matSource, int blur_Size = 5, int sobel_Scale = 1,
-        int sobel_Delta = 0, int sobel_X_Weight = 1, int sobel_Y_Weight = 0,
-        int morph_Size_Width = 17, int morph_Size_Height = 3, int minWidth = 60,
-        int maxWidth = 180, int minHeight = 18, int maxHeight = 80,
-        float minRatio = 0.15f, float maxRatio = 0.70f);
+    static vector<PlateInfo>
+    LocatePlatesCoarseToFine(const PlateCategory_SVM &plateCategorySVM,
+                             const Mat &matSource,
+                             const Mat &regionMask,
+                             const PlateLocatorConfig &config,
+                             PlateLocatorScratch &scratch,
+                             ThreadPool *taskPool);
+
+    // config 中的 RegionOfInterest 与 RegionPolygon 的外接矩形的交集，
+    // 有多边形时在 regionMask 中画出它在这个矩形内的部分，否则清空 regionMask
+    static Rect GetRegion(const PlateLocatorConfig &config,
+                          const cv::Size &sourceSize, Mat &regionMask);
+
+    // 缩小 scale 倍后使用的参数，尺寸限制适当放宽，避免取整丢掉候选
+    static PlateLocatorConfig ScaleConfig(const PlateLocatorConfig &config,
+                                          int scale);
+
+    // 尺寸符合 coarseConfig 的轮廓，放大回原图坐标并向外扩展后合并重叠的区域
+    static vector<Rect> GetCoarseRegions(const vector<vector<Point>> &contours,
+                                         const PlateLocatorConfig &config,
+                                         const PlateLocatorConfig &coarseConfig,
+                                         int scale, const cv::Size &sourceSize);
+
+    static PlateLocatorConfig
+    MakeConfig(int blur_Size, int sobel_Scale, int sobel_Delta,
+               int sobel_X_Weight, int sobel_Y_Weight, int morph_Size_Width,
+               int morph_Size_Height, int minWidth, int maxWidth,
+               int minHeight, int maxHeight, float minRatio, float maxRatio);
 };
 
 } // namespace PlateRecogn
@@ -5,14 +5,63 @@
 #include "PlateLocator_V3.h"
 #include "PlateRecognition_V3.h"
 #include "PlateChar_SVM.h"
+#include "PlateLayout.h"
+#include "StageTimer.h"
+#include <algorithm>
+#include <iterator>
 #include <numeric>
+#include <optional>
+#include <utility>
 
 using namespace Doit::CV::PlateRecogn;
 
-vector<PlateInfo> PlateRecognition_V3::Recognite(Mat &matSource) {
+namespace {
+PipelineStage_t GetSplitStage(CharSplitMethod_t splitMethod) {
+    switch (splitMethod) {
+    case CharSplitMethod_t::Gamma:
+        return PipelineStage_t::SplitGamma;
+    case CharSplitMethod_t::Exponential:
+        return PipelineStage_t::SplitExponential;
+    case CharSplitMethod_t::Log:
+        return PipelineStage_t::SplitLog;
+    default:
+        return PipelineStage_t::SplitOrigin;
+    }
+}
+} // namespace
+
+PlateRecognition_V3::PlateRecognition_V3(const string &categoryModelFile,
+                                         const string &charModelFile) {
+    Load(categoryModelFile, charModelFile);
+}
+
+void PlateRecognition_V3::Load(const string &categoryModelFile,
+                               const string &charModelFile) {
+    CategorySVM.Load(categoryModelFile);
+    CharSVM.Load(charModelFile);
+}
+
+void PlateRecognition_V3::LoadCharCascade(const string &charCascadeModelFile) {
+    CharCascade.Load(charCascadeModelFile);
+}
+
+bool PlateRecognition_V3::IsReady() const {
+    return CategorySVM.IsReady && (CharSVM.IsReady || CharCascade.IsReady);
+}
+
+vector<PlateInfo> PlateRecognition_V3::Recognite(const Mat &matSource) const {
+    PlateLocatorScratch scratch;
+    return Recognite(matSource, scratch);
+}
+
+vector<PlateInfo>
+PlateRecognition_V3::Recognite(const Mat &matSource,
+                               PlateLocatorScratch &scratch) const {
+    StageRecording recording(stageStatistics);
     vector<PlateInfo> result = vector<PlateInfo>();
-    vector<PlateInfo> plateInfosLocate =
-        PlateLocator_V3::LocatePlates(matSource);
+    vector<PlateInfo> plateInfosLocate = PlateLocator_V3::LocatePlates(
+        CategorySVM, matSource, Config.Locator, scratch,
+        UseTaskPool() ? TaskPool.get() : null);
     for (size_t index = 0; index < plateInfosLocate.size(); index++) {
         PlateInfo plateInfo = plateInfosLocate[index];
         shared_ptr<PlateInfo> plateInfoOfHandled =
@@ -26,17 +75,122 @@ vector<PlateInfo> PlateRecognition_V3::Recognite(Mat &matSource) {
     return result;
 }
 
+vector<vector<PlateInfo>>
+PlateRecognition_V3::RecogniteBatch(const Mat *frames,
+                                    size_t frameCount) const {
+    vector<vector<PlateInfo>> results(frameCount);
+    if (frameCount == 0)
+        return results;
+    if (!UseTaskPool()) {
+        PlateLocatorScratch scratch;
+        for (size_t index = 0; index < frameCount; index++) {
+            results[index] = Recognite(frames[index], scratch);
+        }
+        return results;
+    }
+
+    // worker 的范围是 [0, TaskPool->Size()]，每个线程一份 scratch
+    vector<PlateLocatorScratch> scratches(TaskPool->Size() + 1);
+    TaskPool->ParallelFor(frameCount, [&](size_t index, size_t worker) {
+        results[index] = Recognite(frames[index], scratches[worker]);
+    });
+    return results;
+}
+
+vector<vector<PlateInfo>>
+PlateRecognition_V3::RecogniteBatch(const vector<Mat> &frames) const {
+    return RecogniteBatch(frames.data(), frames.size());
+}
+
+CandidateStatistics PlateRecognition_V3::GetCandidateStatistics() const {
+    CandidateStatistics statistics;
+    statistics.PlateCount = plateCount;
+    statistics.EvaluatedCount = evaluatedCount;
+    statistics.SkippedCount = skippedCount;
+    return statistics;
+}
+
+const StageStatistics &PlateRecognition_V3::GetStageStatistics() const {
+    return stageStatistics;
+}
+
+void PlateRecognition_V3::ResetStageStatistics() { stageStatistics.Reset(); }
+
+void PlateRecognition_V3::ResetCandidateStatistics() {
+    plateCount = 0;
+    evaluatedCount = 0;
+    skippedCount = 0;
+    for (auto &wins : splitMethodWins) {
+        wins = 0;
+    }
+}
+
 // 返回值可能是null，改成指针
 shared_ptr<PlateInfo>
 PlateRecognition_V3::GetPlateInfoByMutilMethodAndMutilColor(
-    PlateInfo &plateInfo) {
+    PlateInfo &plateInfo) const {
     PlateInfo *result = null;
     if (plateInfo.OriginalMat.empty())
         return shared_ptr<PlateInfo>(result);
-    PlateInfo plateInfo_Blue =
-        GetPlateInfoByMutilMethod(plateInfo, PlateColor_t::BluePlate);
-    PlateInfo plateInfo_Yello =
-        GetPlateInfoByMutilMethod(plateInfo, PlateColor_t::YellowPlate);
+
+    ++plateCount;
+    const PlateColor_t plateColors[] = {PlateColor_t::BluePlate,
+                                        PlateColor_t::YellowPlate};
+    const size_t colorCount = std::size(plateColors);
+    PlateInfo plateInfo_Blue;
+    PlateInfo plateInfo_Yello;
+    // 两种颜色的切分共用变换后的灰度图
+    SplitTransformCache transforms(plateInfo.OriginalMat,
+                                   Config.SplitTransformInput);
+
+    if (Config.CandidatePolicy == CandidatePolicy_t::FirstGoodEnough) {
+        // 每种颜色内部按顺序尝试，两种颜色之间可以并行
+        vector<PlateInfo> plateInfosByColor(colorCount);
+        auto computeColor = [&](size_t index, size_t) {
+            plateInfosByColor[index] =
+                GetPlateInfoByFirstGoodEnough(plateInfo, plateColors[index],
+                                              &transforms);
+        };
+        if (UseTaskPoolForCandidates()) {
+            TaskPool->ParallelFor(colorCount, computeColor);
+        } else {
+            for (size_t index = 0; index < colorCount; index++) {
+                computeColor(index, 0);
+            }
+        }
+        plateInfo_Blue = plateInfosByColor[0];
+        plateInfo_Yello = plateInfosByColor[1];
+    } else {
+        // 8 个候选互不依赖，先全部算出来，再按原来的顺序选出结果，
+        // 所以并行和串行选出的车牌完全一样
+        const CharSplitMethod_t splitMethods[] = {
+            CharSplitMethod_t::Origin, CharSplitMethod_t::Gamma,
+            CharSplitMethod_t::Exponential, CharSplitMethod_t::Log};
+        const size_t methodCount = std::size(splitMethods);
+        vector<PlateInfo> candidates(colorCount * methodCount);
+        auto computeCandidate = [&](size_t index, size_t) {
+            candidates[index] =
+                GetPlateInfo(plateInfo, plateColors[index / methodCount],
+                             splitMethods[index % methodCount], &transforms);
+        };
+        if (UseTaskPoolForCandidates()) {
+            TaskPool->ParallelFor(candidates.size(), computeCandidate);
+        } else {
+            for (size_t index = 0; index < candidates.size(); index++) {
+                computeCandidate(index, 0);
+            }
+        }
+        evaluatedCount += candidates.size();
+
+        vector<PlateInfo> candidates_Blue(candidates.begin(),
+                                          candidates.begin() + methodCount);
+        vector<PlateInfo> candidates_Yello(candidates.begin() + methodCount,
+                                           candidates.end());
+        plateInfo_Blue = SelectPlateInfoByMutilMethod(candidates_Blue);
+        plateInfo_Yello = SelectPlateInfoByMutilMethod(candidates_Yello);
+        CountSplitMethodWin(plateInfo_Blue);
+        CountSplitMethodWin(plateInfo_Yello);
+    }
 
     if (GetCharCount(plateInfo_Blue) > GetCharCount(plateInfo_Yello)) {
         plateInfo_Blue.PlateColor = PlateColor_t::BluePlate;
@@ -62,6 +216,16 @@ bool PlateRecognition_V3::JudgePlateRightful(const PlateInfo &plateInfo) {
     return (charCount >= 5);
 }
 
+size_t
+PlateRecognition_V3::GetExpectedCharCount(PlateCategory_t plateCategory) {
+    switch (plateCategory) {
+    case PlateCategory_t::AlternativeEnergyPlate:
+        return 8;
+    default:
+        return 7;
+    }
+}
+
 int PlateRecognition_V3::GetCharCount(const PlateInfo &plateInfo) {
     if (plateInfo.CharInfos.empty() || plateInfo.CharInfos.size() == 0)
         return 0;
@@ -78,39 +242,148 @@ int PlateRecognition_V3::GetCharCount(const PlateInfo &plateInfo) {
 
 PlateInfo
 PlateRecognition_V3::GetPlateInfoByMutilMethod(PlateInfo &plateInfo,
-    PlateColor_t plateColor) {
-    PlateInfo plateInfoByOriginal =
-        GetPlateInfo(plateInfo, plateColor, CharSplitMethod_t::Origin);
-    PlateInfo plateInfoByGamma =
-        GetPlateInfo(plateInfo, plateColor, CharSplitMethod_t::Gamma);
-    PlateInfo plateInfoByIndex =
-        GetPlateInfo(plateInfo, plateColor, CharSplitMethod_t::Exponential);
-    PlateInfo plateInfoByLog =
-        GetPlateInfo(plateInfo, plateColor, CharSplitMethod_t::Log);
-    vector<PlateInfo> plateInfos = vector<PlateInfo>();
-    if (!plateInfoByOriginal.CharInfos.empty()) {
-        plateInfos.push_back(plateInfoByOriginal);
+    PlateColor_t plateColor, SplitTransformCache *transforms) const {
+    ++plateCount;
+    if (Config.CandidatePolicy == CandidatePolicy_t::FirstGoodEnough)
+        return GetPlateInfoByFirstGoodEnough(plateInfo, plateColor,
+                                             transforms);
+
+    const CharSplitMethod_t splitMethods[] = {
+        CharSplitMethod_t::Origin, CharSplitMethod_t::Gamma,
+        CharSplitMethod_t::Exponential, CharSplitMethod_t::Log};
+    vector<PlateInfo> plateInfos(std::size(splitMethods));
+    auto computeCandidate = [&](size_t index, size_t) {
+        plateInfos[index] =
+            GetPlateInfo(plateInfo, plateColor, splitMethods[index],
+                         transforms);
+    };
+    if (UseTaskPoolForCandidates()) {
+        TaskPool->ParallelFor(plateInfos.size(), computeCandidate);
+    } else {
+        for (size_t index = 0; index < plateInfos.size(); index++) {
+            computeCandidate(index, 0);
+        }
     }
-    if (!plateInfoByGamma.CharInfos.empty()) {
-        plateInfos.push_back(plateInfoByGamma);
+    evaluatedCount += plateInfos.size();
+    PlateInfo result = SelectPlateInfoByMutilMethod(plateInfos);
+    CountSplitMethodWin(result);
+    return result;
+}
+
+PlateInfo
+PlateRecognition_V3::GetPlateInfoByFirstGoodEnough(PlateInfo &plateInfo,
+    PlateColor_t plateColor, SplitTransformCache *transforms) const {
+    vector<CharSplitMethod_t> splitMethods = GetSplitMethodOrder();
+    size_t expectedCharCount = GetExpectedCharCount(plateInfo.PlateCategory);
+    vector<std::pair<CharSplitMethod_t, PlateInfo>> candidates;
+    for (size_t index = 0; index < splitMethods.size(); index++) {
+        PlateInfo candidate =
+            GetPlateInfo(plateInfo, plateColor, splitMethods[index],
+                         transforms);
+        ++evaluatedCount;
+        if (candidate.CharInfos.size() >= expectedCharCount &&
+            JudgePlateRightful(candidate)) {
+            skippedCount += splitMethods.size() - index - 1;
+            ++splitMethodWins[static_cast<size_t>(splitMethods[index])];
+            return candidate;
+        }
+        candidates.emplace_back(splitMethods[index], candidate);
     }
-    if (!plateInfoByIndex.CharInfos.empty()) {
-        plateInfos.push_back(plateInfoByIndex);
+
+    // 没有足够好的，和 Exhaustive 一样取字符数最多的。尝试的顺序可能被
+    // 调整过，先按 Origin, Gamma, Exponential, Log 排好，字符数相同时
+    // 选出的与 Exhaustive 一样
+    std::stable_sort(candidates.begin(), candidates.end(),
+        [](const auto &x, const auto &y) { return x.first < y.first; });
+    vector<PlateInfo> plateInfos;
+    for (auto &candidate : candidates) {
+        plateInfos.push_back(candidate.second);
     }
-    if (!plateInfoByLog.CharInfos.empty()) {
-        plateInfos.push_back(plateInfoByLog);
+    PlateInfo result = SelectPlateInfoByMutilMethod(plateInfos);
+    CountSplitMethodWin(result);
+    return result;
+}
+
+vector<CharSplitMethod_t> PlateRecognition_V3::GetSplitMethodOrder() const {
+    vector<CharSplitMethod_t> splitMethods = Config.SplitMethodOrder;
+    if (Config.LearnSplitMethodOrder) {
+        // 其他线程可能同时在累加，这里只需要一个大致的次数
+        vector<size_t> wins(std::size(splitMethodWins));
+        for (size_t index = 0; index < wins.size(); index++) {
+            wins[index] = splitMethodWins[index];
+        }
+        std::stable_sort(splitMethods.begin(), splitMethods.end(),
+            [&](CharSplitMethod_t x, CharSplitMethod_t y) {
+            return wins[static_cast<size_t>(x)] > wins[static_cast<size_t>(y)];
+        });
+    }
+    return splitMethods;
+}
+
+void PlateRecognition_V3::CountSplitMethodWin(const PlateInfo &plateInfo) const {
+    if (plateInfo.CharInfos.empty())
+        return;
+    CharSplitMethod_t splitMethod = plateInfo.CharInfos[0].CharSplitMethod;
+    ++splitMethodWins[static_cast<size_t>(splitMethod)];
+}
+
+void PlateRecognition_V3::TestChars(const vector<Mat> &charMats,
+                                    const vector<PlateCharSet> &allowed,
+                                    vector<PlateChar_t> &plateChars) const {
+    StageTimer timer(PipelineStage_t::CharSVM);
+    if (CharCascade.IsReady)
+        CharCascade.Test(charMats, allowed, plateChars);
+    else if (Config.ConstrainCharsByLayout)
+        CharSVM.Test(charMats, allowed, plateChars);
+    else
+        CharSVM.Test(charMats, plateChars);
+}
+
+PlateChar_t PlateRecognition_V3::TestChar(const Mat &charMat,
+                                          const PlateCharSet &allowed) const {
+    StageTimer timer(PipelineStage_t::CharSVM);
+    if (CharCascade.IsReady)
+        return CharCascade.Test(charMat, allowed);
+    // 不按版式识别时与原来一样，单独的 SVM 不限制类别
+    if (!Config.ConstrainCharsByLayout)
+        return CharSVM.Test(charMat);
+    return CharSVM.Test(charMat, allowed);
+}
+
+bool PlateRecognition_V3::UseTaskPool() const {
+#if defined(VISUALIZE_DEBUG) || defined(SAVE_INTERNAL_IMAGE)
+    // 调试输出用到全局变量和窗口，只能在一个线程里做
+    return false;
+#else
+    return TaskPool != null;
+#endif
+}
+
+bool PlateRecognition_V3::UseTaskPoolForCandidates() const {
+    return UseTaskPool() && Config.ParallelCandidates;
+}
+
+// plateInfos 按 Origin, Gamma, Exponential, Log 的顺序排列
+PlateInfo PlateRecognition_V3::SelectPlateInfoByMutilMethod(
+    vector<PlateInfo> &plateInfos) {
+    for (size_t index = plateInfos.size() - 1; index < plateInfos.size();
+        index--) {
+        if (plateInfos[index].CharInfos.empty())
+            plateInfos.erase(plateInfos.begin() + index);
     }
     if (plateInfos.size() == 0)
         return PlateInfo();
-    sort(plateInfos.begin(), plateInfos.end(), PlateInfoComparer_DESC());
+    // 字符数相同时取排在前面的
+    std::stable_sort(plateInfos.begin(), plateInfos.end(),
+                     PlateInfoComparer_DESC());
 
     PlateInfo result = plateInfos[0];
     return result;
 }
 
 PlateInfo PlateRecognition_V3::GetPlateInfo(PlateInfo &plateInfo,
-    PlateColor_t plateColor,
-    CharSplitMethod_t splitMethod) {
+    PlateColor_t plateColor, CharSplitMethod_t splitMethod,
+    SplitTransformCache *transforms) const {
     PlateInfo result = PlateInfo();
     result.PlateCategory = plateInfo.PlateCategory;
     result.OriginalMat = plateInfo.OriginalMat;
@@ -119,26 +392,26 @@ PlateInfo PlateRecognition_V3::GetPlateInfo(PlateInfo &plateInfo,
     result.PlateColor = plateColor;
     vector<CharInfo> charInfos = vector<CharInfo>();
 
+    // 两种方法只会用到其中一个
     std::vector<std::vector<cv::Point>> contours;
-
-    switch (splitMethod) {
-    case CharSplitMethod_t::Gamma:
-        charInfos = CharSegment_V3::SplitePlateByGammaTransform(
-            contours, plateInfo.OriginalMat, plateColor);
-        break;
-    case CharSplitMethod_t::Exponential:
-        charInfos = CharSegment_V3::SplitePlateByIndexTransform(
-            contours, plateInfo.OriginalMat, plateColor);
-        break;
-    case CharSplitMethod_t::Log:
-        charInfos = CharSegment_V3::SplitePlateByLogTransform(
-            contours, plateInfo.OriginalMat, plateColor);
-        break;
-    case CharSplitMethod_t::Origin:
-    default:
-        charInfos = CharSegment_V3::SplitePlateByOriginal(
-            contours, plateInfo.OriginalMat, plateInfo.OriginalMat, plateColor);
-        break;
+    vector<CharCandidate> candidates;
+
+    {
+        StageTimer timer(GetSplitStage(splitMethod));
+        std::optional<SplitTransformCache> plateTransforms;
+        SplitTransformCache *cache = transforms;
+        if (cache == null) {
+            plateTransforms.emplace(plateInfo.OriginalMat,
+                                    Config.SplitTransformInput);
+            cache = &*plateTransforms;
+        }
+        if (Config.CharCandidateExtractor ==
+            CharCandidateExtractor_t::ConnectedComponents)
+            charInfos = CharSegment_V3::SplitePlate(candidates, *cache,
+                                                    plateColor, splitMethod);
+        else
+            charInfos = CharSegment_V3::SplitePlate(contours, *cache,
+                                                    plateColor, splitMethod);
     }
 
     auto combineVerticalOrigin = [](vector<CharInfo> &charInfos,
@@ -179,19 +452,31 @@ PlateInfo PlateRecognition_V3::GetPlateInfo(PlateInfo &plateInfo,
     // }
     // DebugVisualize("combined Rects ", combinedMat);
 
-    for (size_t index = charInfos.size() - 1; index < charInfos.size();
-        index--) {
-        CharInfo &charInfo = charInfos[index];
-        PlateChar_t plateChar = PlateChar_SVM::Test(charInfo.OriginalMat);
-        if (plateChar == PlateChar_t::NonChar) {
-            charInfos.erase(index + charInfos.begin());
-        }
-        else
-            charInfo.PlateChar = plateChar;
+    // 所有字符一次送进 SVM，核函数按矩阵计算
+    vector<Mat> charMats;
+    for (auto &charInfo : charInfos) {
+        charMats.push_back(charInfo.OriginalMat);
     }
-    result.CharInfos = charInfos;
-
-    CheckLeftAndRightToRemove(result);
+    // 每个字符只在车牌版式允许的类别中识别，之后去掉非字符
+    const PlateLayout &layout = PlateLayout::Get(plateInfo.PlateCategory);
+    vector<PlateChar_t> plateChars;
+    TestChars(charMats,
+              Config.ConstrainCharsByLayout
+                  ? layout.GetAllowedChars(charMats.size())
+                  : vector<PlateCharSet>(charMats.size(), GetAllPlateChars()),
+              plateChars);
+    for (size_t index = 0; index < charInfos.size(); index++) {
+        if (plateChars[index] == PlateChar_t::NonChar)
+            continue;
+        charInfos[index].PlateChar = plateChars[index];
+        result.CharInfos.push_back(charInfos[index]);
+    }
+    // 之后的修正一直计到返回，其中再识别字符的时间算在 CharSVM 里
+    StageTimer postProcessTimer(PipelineStage_t::PostProcess);
+    if (Config.ConstrainCharsByLayout)
+        layout.Trim(result.CharInfos);
+    else
+        CheckLeftAndRightToRemove(result);
     CheckPlateColor(result);
 
     auto rectCenter = [](const Rect &rect) {
@@ -259,13 +544,19 @@ PlateInfo PlateRecognition_V3::GetPlateInfo(PlateInfo &plateInfo,
                 }
                 result.CharInfos.erase(result.CharInfos.begin() + i);
                 Mat thinMat = plateInfo.OriginalMat(rect);
-                PlateChar_t thinChar = PlateChar_SVM::Test(thinMat);
+                PlateChar_t thinChar = TestChar(thinMat);
                 result.CharInfos.insert(result.CharInfos.begin() + i,
                 { thinChar, plateInfo.OriginalMat(rect),
                     rect, PlateLocateMethod_t::Unknown, splitMethod });
             }
         }
     };
+    // 补回的第一个字符只能是汉字（按版式识别时是版式第一个位置的汉字）或非字符
+    PlateCharSet firstAllowed =
+        GetPlateCharSet(PlateChar_t::NonChar, PlateChar_t::NonChar) |
+        (Config.ConstrainCharsByLayout && layout.IsFixed()
+             ? layout.GetSlot(0)
+             : GetPlateCharSet(CharGroup_t::Hanzi));
     auto checkStartChineseCharacter = [&](PlateInfo &result) {
         const vector<CharInfo> &charInfos = result.CharInfos;
         if (charInfos.size() == 0) {
@@ -309,8 +600,15 @@ PlateInfo PlateRecognition_V3::GetPlateInfo(PlateInfo &plateInfo,
                     cv::Size(meanWidth + 5 * 2, meanHeight + 5 * 2));
             vector<CharInfo> intersected = {};
             Rect firstCharRect;
+            // 只有这里用到切分的全部候选，轮廓的外接矩形到这里才计算
+            vector<Rect> candidateRects;
+            for (auto &candidate : candidates) {
+                candidateRects.push_back(candidate.BoundingRect);
+            }
             for (auto &ct : contours) {
-                Rect bRect = cv::boundingRect(ct);
+                candidateRects.push_back(cv::boundingRect(ct));
+            }
+            for (auto &bRect : candidateRects) {
                 bool intersectInternal = (bRect & first).area() > 0;
                 bool containOuter = (bRect & firstOutLimit) == bRect;
                 if (intersectInternal && containOuter) {
@@ -326,7 +624,8 @@ PlateInfo PlateRecognition_V3::GetPlateInfo(PlateInfo &plateInfo,
             DebugVisualize("fistInner", fistInner);
 
             Mat firstMat = plateInfo.OriginalMat(firstCharRect);
-            PlateChar_t firstRecoginzedChar = PlateChar_SVM::Test(firstMat);
+            PlateChar_t firstRecoginzedChar =
+                TestChar(firstMat, firstAllowed);
             if (firstRecoginzedChar >= PlateChar_t::BeiJing &&
                 firstRecoginzedChar <= PlateChar_t::JingChe) {
                 result.CharInfos.insert(
@@ -9,6 +9,8 @@ using std::min;
 using std::sort;
 #include <string>
 using std::string;
+#include <atomic>
+#include <iterator>
 
 /*--------  Forward declarations  --------*/
 namespace Doit {
@@ -20,33 +22,153 @@ class PlateInfo;
 } // namespace Doit
 
 #include "csharpImplementations.h"
+#include "CharInfo.h"
+#include "CharSegment_V3.h"
+#include "PlateCategory_SVM.h"
+#include "PlateCharCascade_SVM.h"
+#include "PlateChar_SVM.h"
+#include "PlateLocator_V3.h"
+#include "StageTimer.h"
+#include "ThreadPool.h"
 
 namespace Doit {
 namespace CV {
 namespace PlateRecogn {
+// 每种颜色下字符切分方法的尝试策略
+enum class CandidatePolicy_t {
+    // 4 种切分方法全部计算，取字符数最多的
+    Exhaustive = 0,
+    // 按 SplitMethodOrder 依次计算，字符数达到车牌类型应有的个数并且
+    // JudgePlateRightful 通过就停止
+    FirstGoodEnough
+};
+
+struct PlateRecognitionConfig {
+    PlateLocatorConfig Locator;
+    // 设置了 TaskPool 时，2 种颜色 x 4 种切分方法的候选结果并行计算
+    bool ParallelCandidates = true;
+    CandidatePolicy_t CandidatePolicy = CandidatePolicy_t::Exhaustive;
+    vector<CharSplitMethod_t> SplitMethodOrder = {
+        CharSplitMethod_t::Origin, CharSplitMethod_t::Gamma,
+        CharSplitMethod_t::Exponential, CharSplitMethod_t::Log};
+    // 按各切分方法被选中的次数重新排列 SplitMethodOrder（次数多的先试）
+    bool LearnSplitMethodOrder = false;
+    // 字符只在车牌版式允许的类别中识别，见 PlateLayout::GetAllowedChars；
+    // 关闭时按所有类别识别，再用 CheckLeftAndRightToRemove 去掉两头的字符
+    // （在 cleanPlateSamples 上比较两者的准确率之前默认关闭）
+    bool ConstrainCharsByLayout = false;
+    // 切分前先转灰度再做增强变换，见 SplitTransformInput_t::Gray
+    SplitTransformInput_t SplitTransformInput = SplitTransformInput_t::Bgr;
+    // 切分时找字符候选的方法，ConnectedComponents 不生成轮廓的点
+    CharCandidateExtractor_t CharCandidateExtractor =
+        CharCandidateExtractor_t::Contours;
+};
+
+// 候选计算的累计统计，一个候选是一次 GetPlateInfo
+struct CandidateStatistics {
+    size_t PlateCount = 0;
+    size_t EvaluatedCount = 0;
+    size_t SkippedCount = 0;
+};
+
+/**
+ * 识别引擎，持有自己的模型和配置，不依赖任何全局状态。
+ *
+ * 线程安全：先 Load 并设置好 Config，之后 Recognite 等 const 成员函数可以被
+ * 多个线程同时调用（每次调用的中间结果都在调用线程自己的栈上）。Load、
+ * 修改 Config 不能和 Recognite 同时进行。定义了 SAVE_INTERNAL_IMAGE /
+ * VISUALIZE_DEBUG 时调试输出使用全局变量，只能单线程使用。
+ */
 class PlateRecognition_V3 {
   public:
-    static vector<PlateInfo> Recognite(Mat &matSource);
+    PlateCategory_SVM CategorySVM;
+    PlateChar_SVM CharSVM;
+    // 加载了级联模型时字符识别改用它，CharSVM 可以不加载
+    PlateCharCascade_SVM CharCascade;
+    PlateRecognitionConfig Config;
+    // 为空时所有步骤都在调用线程上串行执行，可以由多个引擎共享
+    shared_ptr<ThreadPool> TaskPool;
+
+  public:
+    PlateRecognition_V3() {}
+    PlateRecognition_V3(const string &categoryModelFile,
+                        const string &charModelFile);
+
+    void Load(const string &categoryModelFile, const string &charModelFile);
+    void LoadCharCascade(const string &charCascadeModelFile);
+
+    bool IsReady() const;
+
+    vector<PlateInfo> Recognite(const Mat &matSource) const;
+
+    // scratch 保存定位的中间结果，连续识别多帧时传同一个 scratch 可以避免
+    // 每帧重新分配内存
+    vector<PlateInfo> Recognite(const Mat &matSource,
+                                PlateLocatorScratch &scratch) const;
+
+    // 识别 frames[0, frameCount)，结果和逐帧调用 Recognite 相同，按帧的顺序
+    // 返回。设置了 TaskPool 时各帧分给池中的线程，每个线程使用自己的 scratch
+    vector<vector<PlateInfo>> RecogniteBatch(const Mat *frames,
+                                             size_t frameCount) const;
+    vector<vector<PlateInfo>> RecogniteBatch(const vector<Mat> &frames) const;
+
+    CandidateStatistics GetCandidateStatistics() const;
+    void ResetCandidateStatistics();
+
+    // 每次 Recognite 各阶段耗时的直方图，只有定义了 PLATE_STAGE_TIMING 时
+    // 才有记录。可以在识别的同时读取
+    const StageStatistics &GetStageStatistics() const;
+    void ResetStageStatistics();
 
     // 返回值可能是null，改成指针
   public:
-    static shared_ptr<PlateInfo>
-    GetPlateInfoByMutilMethodAndMutilColor(PlateInfo &plateInfo);
+    shared_ptr<PlateInfo>
+    GetPlateInfoByMutilMethodAndMutilColor(PlateInfo &plateInfo) const;
 
   public:
     static bool JudgePlateRightful(const PlateInfo &plateInfo);
 
     static int GetCharCount(const PlateInfo &plateInfo);
 
+    // 车牌类型应有的字符个数
+    static size_t GetExpectedCharCount(PlateCategory_t plateCategory);
+
+    // transforms 缓存 plateInfo.OriginalMat 各切分方法的灰度图，同一块车牌
+    // 的各个候选（包括两种颜色）传同一个缓存可以避免重复计算；为空时每次
+    // 调用各自计算
   public:
-    static PlateInfo GetPlateInfoByMutilMethod(PlateInfo &plateInfo,
-                                               PlateColor_t plateColor);
+    PlateInfo
+    GetPlateInfoByMutilMethod(PlateInfo &plateInfo, PlateColor_t plateColor,
+                              SplitTransformCache *transforms = null) const;
+
+    PlateInfo
+    GetPlateInfoByFirstGoodEnough(PlateInfo &plateInfo, PlateColor_t plateColor,
+                                  SplitTransformCache *transforms = null) const;
 
   public:
-    static PlateInfo GetPlateInfo(PlateInfo &plateInfo, PlateColor_t plateColor,
-                                  CharSplitMethod_t splitMethod);
+    PlateInfo GetPlateInfo(PlateInfo &plateInfo, PlateColor_t plateColor,
+                           CharSplitMethod_t splitMethod,
+                           SplitTransformCache *transforms = null) const;
 
   private:
+    bool UseTaskPool() const;
+    bool UseTaskPoolForCandidates() const;
+
+    vector<CharSplitMethod_t> GetSplitMethodOrder() const;
+    // 选中的车牌由哪种切分方法得到，累加到 splitMethodWins
+    void CountSplitMethodWin(const PlateInfo &plateInfo) const;
+
+    // 加载了 CharCascade 时用级联分类，否则用 CharSVM。allowed[i] 是
+    // charMats[i] 可能的类别，见 PlateLayout::GetAllowedChars
+    void TestChars(const vector<Mat> &charMats,
+                   const vector<PlateCharSet> &allowed,
+                   vector<PlateChar_t> &plateChars) const;
+    PlateChar_t TestChar(const Mat &charMat,
+                         const PlateCharSet &allowed = GetAllPlateChars()) const;
+
+    static PlateInfo SelectPlateInfoByMutilMethod(vector<PlateInfo> &plateInfos);
+
+    // 不按版式识别时（ConstrainCharsByLayout = false）去掉两头多出的字符
     static void CheckLeftAndRightToRemove(PlateInfo &plateInfo);
 
   private:
@@ -57,6 +179,15 @@ class PlateRecognition_V3 {
       public:
         bool operator()(const PlateInfo &x, const PlateInfo &y);
     };
+
+    // Recognite 是 const 的，统计用原子变量累加，多线程下不加锁
+    mutable std::atomic<size_t> plateCount{0};
+    mutable std::atomic<size_t> evaluatedCount{0};
+    mutable std::atomic<size_t> skippedCount{0};
+    // 按 CharSplitMethod_t 的值索引
+    mutable std::atomic<size_t> splitMethodWins[std::size(
+        CharSplitMethod_tToString)] = {};
+    mutable StageStatistics stageStatistics;
 };
 } // namespace PlateRecogn
 } // namespace CV
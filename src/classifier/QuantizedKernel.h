@@ -0,0 +1,167 @@
+#ifndef QUANTIZED_KERNEL_H
+#define QUANTIZED_KERNEL_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__) || (defined(_MSC_VER) && defined(__AVX__))
+#include <smmintrin.h>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+#endif
+
+namespace Doit {
+namespace CV {
+namespace PlateRecogn {
+
+/**
+ * 量化支持向量与 float 样本的点积。支持向量按 int8 或 fp16 存放，读进来
+ * 之后转成 float 再乘加，内存带宽是 float 的 1/4 或 1/2。
+ *
+ * 每次读一个支持向量，同时与 SampleGroup 个样本求点积，批量预测时支持
+ * 向量矩阵只需要扫一遍。int8 的每一维缩放系数事先乘到样本上。
+ *
+ * 编译时打开 AVX2 / SSE4.1 时一次处理 8 / 4 维；fp16 的向量转换还需要
+ * F16C (-mf16c)，否则逐个转换。
+ */
+namespace QuantizedKernel {
+const int SampleGroup = 4;
+
+// IEEE 754 半精度转 float，包括非规格化数、无穷和 NaN
+inline float HalfToFloat(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        exponent = 113;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#if defined(__AVX2__)
+const int Width = 8;
+typedef __m256 Float;
+inline Float Zero() { return _mm256_setzero_ps(); }
+inline Float Load(const float *p) { return _mm256_loadu_ps(p); }
+inline Float LoadInt8(const int8_t *p) {
+    __m128i bytes = _mm_loadl_epi64((const __m128i *)p);
+    return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+}
+#if defined(__F16C__)
+inline Float LoadHalf(const uint16_t *p) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)p));
+}
+#else
+inline Float LoadHalf(const uint16_t *p) {
+    float values[Width];
+    for (int i = 0; i < Width; i++)
+        values[i] = HalfToFloat(p[i]);
+    return _mm256_loadu_ps(values);
+}
+#endif
+inline Float MulAdd(Float a, Float b, Float c) {
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+inline float Sum(Float v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v),
+                            _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+#elif defined(__SSE4_1__) || (defined(_MSC_VER) && defined(__AVX__))
+const int Width = 4;
+typedef __m128 Float;
+inline Float Zero() { return _mm_setzero_ps(); }
+inline Float Load(const float *p) { return _mm_loadu_ps(p); }
+inline Float LoadInt8(const int8_t *p) {
+    int32_t bytes;
+    std::memcpy(&bytes, p, sizeof(bytes));
+    return _mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(bytes)));
+}
+#if defined(__F16C__)
+inline Float LoadHalf(const uint16_t *p) {
+    return _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *)p));
+}
+#else
+inline Float LoadHalf(const uint16_t *p) {
+    return _mm_setr_ps(HalfToFloat(p[0]), HalfToFloat(p[1]),
+                       HalfToFloat(p[2]), HalfToFloat(p[3]));
+}
+#endif
+inline Float MulAdd(Float a, Float b, Float c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+inline float Sum(Float v) {
+    __m128 sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+#else
+const int Width = 1;
+typedef float Float;
+inline Float Zero() { return 0.f; }
+inline Float Load(const float *p) { return *p; }
+inline Float LoadInt8(const int8_t *p) { return (float)*p; }
+inline Float LoadHalf(const uint16_t *p) { return HalfToFloat(*p); }
+inline Float MulAdd(Float a, Float b, Float c) { return a * b + c; }
+inline float Sum(Float v) { return v; }
+#endif
+
+inline float ToFloat(int8_t value) { return (float)value; }
+inline float ToFloat(uint16_t value) { return HalfToFloat(value); }
+inline Float LoadVector(const int8_t *p) { return LoadInt8(p); }
+inline Float LoadVector(const uint16_t *p) { return LoadHalf(p); }
+
+// results[k] = samples[k] . vector，k < SampleGroup，每个样本 length 维。
+// 样本不够一组时调用者可以重复传同一个样本
+template <typename T>
+inline void Dot(const float *const samples[SampleGroup], const T *vector,
+                int length, float results[SampleGroup]) {
+    Float sum0 = Zero(), sum1 = Zero(), sum2 = Zero(), sum3 = Zero();
+    int d = 0;
+    for (; d + Width <= length; d += Width) {
+        Float value = LoadVector(vector + d);
+        sum0 = MulAdd(Load(samples[0] + d), value, sum0);
+        sum1 = MulAdd(Load(samples[1] + d), value, sum1);
+        sum2 = MulAdd(Load(samples[2] + d), value, sum2);
+        sum3 = MulAdd(Load(samples[3] + d), value, sum3);
+    }
+    results[0] = Sum(sum0);
+    results[1] = Sum(sum1);
+    results[2] = Sum(sum2);
+    results[3] = Sum(sum3);
+    for (; d < length; d++) {
+        float value = ToFloat(vector[d]);
+        for (int k = 0; k < SampleGroup; k++)
+            results[k] += samples[k][d] * value;
+    }
+}
+} // namespace QuantizedKernel
+
+} // namespace PlateRecogn
+} // namespace CV
+} // namespace Doit
+
+#endif // !QUANTIZED_KERNEL_H
@@ -0,0 +1,659 @@
+#include "SVMPredictor.h"
+#include "MappedFile.h"
+#include "QuantizedKernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+using std::logic_error;
+
+using namespace Doit::CV::PlateRecogn;
+
+namespace {
+// 二进制模型文件：文件头之后是各个数组，每个数组的起点按 64 字节对齐
+const char BinaryMagic[8] = {'D', 'O', 'I', 'T', 'S', 'V', 'M', '\0'};
+const uint32_t BinaryVersion = 2;
+const uint32_t ByteOrderMark = 0x01020304;
+const uint64_t SectionAlignment = 64;
+
+enum BinarySection {
+    LabelsSection,
+    VectorsSection,
+    NormsSection,
+    RhosSection,
+    FunctionStartsSection,
+    SVIndicesSection,
+    AlphasSection,
+    WeightsSection,
+    BiasesSection,
+    ScalesSection,
+    SectionCount
+};
+
+struct BinaryHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t ByteOrder;
+    int32_t KernelType;
+    int32_t VectorStorage;
+    int32_t ClassCount;
+    int32_t FunctionCount;
+    int32_t VarCount;
+    int32_t VectorCount;
+    int32_t AlphaCount;
+    int32_t WeightCols;
+    // winSize, blockSize, blockStride, cellSize 的宽高，nbins
+    int32_t Hog[9];
+    double Gamma;
+    double Coef0;
+    double Degree;
+    // 没有的数组起点和长度都是 0
+    uint64_t SectionOffsets[SectionCount];
+    uint64_t SectionSizes[SectionCount];
+};
+
+// allowed 的一行，全为 0（不限制）时返回 nullptr
+const uchar *GetAllowedRow(const Mat *allowed, int row) {
+    if (allowed == nullptr)
+        return nullptr;
+    const uchar *flags = allowed->ptr<uchar>(row);
+    for (int col = 0; col < allowed->cols; col++) {
+        if (flags[col] != 0)
+            return flags;
+    }
+    return nullptr;
+}
+
+uint64_t AlignSection(uint64_t offset) {
+    return (offset + SectionAlignment - 1) / SectionAlignment *
+           SectionAlignment;
+}
+
+// 每 SampleGroup 个样本扫一遍量化后的支持向量，dot 是 样本数 x 支持向量数
+template <typename T>
+void ComputeQuantizedDot(const Mat &samples, const Mat &vectors, Mat &dot) {
+    using QuantizedKernel::SampleGroup;
+    dot.create(samples.rows, vectors.rows, CV_32FC1);
+    float results[SampleGroup];
+    for (int row = 0; row < samples.rows; row += SampleGroup) {
+        const float *group[SampleGroup];
+        for (int k = 0; k < SampleGroup; k++) {
+            group[k] = samples.ptr<float>(std::min(row + k, samples.rows - 1));
+        }
+        int count = std::min(SampleGroup, samples.rows - row);
+        for (int index = 0; index < vectors.rows; index++) {
+            QuantizedKernel::Dot(group, vectors.ptr<T>(index), vectors.cols,
+                                 results);
+            for (int k = 0; k < count; k++) {
+                dot.at<float>(row + k, index) = results[k];
+            }
+        }
+    }
+}
+} // namespace
+
+bool SVMPredictor::Compile(const Ptr<SVM> &svm) {
+    Clear();
+    if (svm == nullptr || !svm->isTrained() || svm->getType() != SVM::C_SVC)
+        return false;
+    int kernel = svm->getKernelType();
+    if (kernel != SVM::LINEAR && kernel != SVM::POLY && kernel != SVM::RBF &&
+        kernel != SVM::SIGMOID)
+        return false;
+
+    // SVM 没有公开类别标签，从它写出的模型里读回来
+    cv::FileStorage writer(".yml", cv::FileStorage::WRITE |
+                                       cv::FileStorage::MEMORY);
+    svm->write(writer);
+    string text = writer.releaseAndGetString();
+    cv::FileStorage reader(text, cv::FileStorage::READ |
+                                     cv::FileStorage::MEMORY);
+    Mat labels;
+    reader["class_labels"] >> labels;
+    if (labels.total() < 2)
+        return false;
+    labels.convertTo(labels, CV_32S);
+    labels = labels.reshape(1, 1);
+
+    kernelType = kernel;
+    gamma = svm->getGamma();
+    coef0 = svm->getCoef0();
+    degree = svm->getDegree();
+    // 线性核的支持向量已经被压缩成每个决策函数一个
+    svm->getSupportVectors().convertTo(supportVectors, CV_32F);
+    if (kernelType == SVM::RBF) {
+        cv::reduce(supportVectors.mul(supportVectors), supportVectorNorms, 1,
+                   cv::REDUCE_SUM, CV_32F);
+        supportVectorNorms = supportVectorNorms.reshape(1, 1);
+    }
+
+    int classCount = (int)labels.total();
+    int functionCount = classCount * (classCount - 1) / 2;
+    vector<double> rhoValues, alphaValues;
+    vector<int> starts = {0}, indices;
+    for (int index = 0; index < functionCount; index++) {
+        Mat alpha, svIndex;
+        rhoValues.push_back(svm->getDecisionFunction(index, alpha, svIndex));
+        alpha.convertTo(alpha, CV_64F);
+        for (int k = 0; k < (int)svIndex.total(); k++) {
+            indices.push_back(svIndex.at<int>(k));
+            alphaValues.push_back(alpha.at<double>(k));
+        }
+        starts.push_back((int)indices.size());
+    }
+    rhos = Mat(rhoValues, true).reshape(1, 1);
+    functionStarts = Mat(starts, true).reshape(1, 1);
+    svIndices = Mat(indices, true).reshape(1, 1);
+    alphas = Mat(alphaValues, true).reshape(1, 1);
+
+    if (kernelType == SVM::LINEAR) {
+        weights = Mat::zeros(functionCount, supportVectors.cols, CV_32FC1);
+        biases.create(1, functionCount, CV_32FC1);
+        for (int index = 0; index < functionCount; index++) {
+            Mat weight = weights.row(index);
+            for (int k = starts[index]; k < starts[index + 1]; k++) {
+                cv::scaleAdd(supportVectors.row(indices[k]), alphaValues[k],
+                             weight, weight);
+            }
+            biases.at<float>(index) = (float)-rhoValues[index];
+        }
+    }
+    classLabels.assign(labels.begin<int>(), labels.end<int>());
+    return true;
+}
+
+bool SVMPredictor::CompileNystrom(const Ptr<SVM> &svm, int landmarkCount) {
+    if (!Compile(svm))
+        return false;
+    int svCount = supportVectors.rows;
+    if (kernelType != SVM::RBF || landmarkCount <= 0 ||
+        landmarkCount >= svCount)
+        return false;
+
+    // 固定种子挑选地标，同一个模型每次展开的结果相同
+    vector<int> landmarkIndices(svCount);
+    std::iota(landmarkIndices.begin(), landmarkIndices.end(), 0);
+    cv::RNG rng(0x5eed);
+    for (int i = 0; i < landmarkCount; i++) {
+        std::swap(landmarkIndices[i],
+                  landmarkIndices[i + rng.uniform(0, svCount - i)]);
+    }
+    Mat landmarks(landmarkCount, supportVectors.cols, CV_32FC1);
+    for (int i = 0; i < landmarkCount; i++) {
+        supportVectors.row(landmarkIndices[i]).copyTo(landmarks.row(i));
+    }
+
+    // 地标到所有支持向量的核函数，其中地标所在的列就是 K_LL
+    Mat landmarkKernel;
+    ComputeKernel(landmarks, landmarkKernel);
+    landmarkKernel.convertTo(landmarkKernel, CV_64F);
+    Mat landmarkGram(landmarkCount, landmarkCount, CV_64F);
+    for (int i = 0; i < landmarkCount; i++) {
+        for (int j = 0; j < landmarkCount; j++) {
+            landmarkGram.at<double>(i, j) =
+                landmarkKernel.at<double>(i, landmarkIndices[j]);
+        }
+    }
+
+    // 每个决策函数的 alpha 展开成 支持向量数 x 类别对数
+    int functionCount = (int)rhos.total();
+    const int *starts = functionStarts.ptr<int>();
+    const int *indices = svIndices.ptr<int>();
+    const double *alphaValues = alphas.ptr<double>();
+    Mat denseAlphas = Mat::zeros(svCount, functionCount, CV_64F);
+    for (int index = 0; index < functionCount; index++) {
+        for (int k = starts[index]; k < starts[index + 1]; k++) {
+            denseAlphas.at<double>(indices[k], index) += alphaValues[k];
+        }
+    }
+
+    // K_LL 的伪逆，忽略相对最大特征值太小的方向
+    Mat eigenvalues, eigenvectors;
+    cv::eigen(landmarkGram, eigenvalues, eigenvectors);
+    double threshold = eigenvalues.at<double>(0) * 1e-8;
+    Mat scaled = eigenvectors.clone();
+    for (int i = 0; i < landmarkCount; i++) {
+        double eigenvalue = eigenvalues.at<double>(i);
+        scaled.row(i) *= eigenvalue > threshold ? 1 / eigenvalue : 0;
+    }
+    Mat folded = eigenvectors.t() * scaled * landmarkKernel * denseAlphas;
+    Mat(folded.t()).convertTo(weights, CV_32F);
+
+    biases.create(1, functionCount, CV_32FC1);
+    for (int index = 0; index < functionCount; index++) {
+        biases.at<float>(index) = (float)-rhos.at<double>(index);
+    }
+    supportVectors = landmarks;
+    cv::reduce(supportVectors.mul(supportVectors), supportVectorNorms, 1,
+               cv::REDUCE_SUM, CV_32F);
+    supportVectorNorms = supportVectorNorms.reshape(1, 1);
+    functionStarts.release();
+    svIndices.release();
+    alphas.release();
+    return true;
+}
+
+bool SVMPredictor::Quantize(VectorStorage target) {
+    if (!IsCompiled() || IsLinear() || storage != VectorStorage::Float32)
+        return false;
+    if (target == VectorStorage::Float32)
+        return true;
+
+    int rows = supportVectors.rows, cols = supportVectors.cols;
+    Mat dequantized(rows, cols, CV_32FC1);
+    if (target == VectorStorage::Int8) {
+        // 每一维按所有支持向量中的最大绝对值缩放到 [-127, 127]
+        vectorScales = Mat::zeros(1, cols, CV_32FC1);
+        float *scale = vectorScales.ptr<float>(0);
+        for (int row = 0; row < rows; row++) {
+            const float *value = supportVectors.ptr<float>(row);
+            for (int col = 0; col < cols; col++) {
+                scale[col] = std::max(scale[col], std::abs(value[col]));
+            }
+        }
+        for (int col = 0; col < cols; col++) {
+            scale[col] = scale[col] > 0 ? scale[col] / 127 : 1;
+        }
+        quantizedVectors.create(rows, cols, CV_8SC1);
+        for (int row = 0; row < rows; row++) {
+            const float *value = supportVectors.ptr<float>(row);
+            int8_t *quantized = quantizedVectors.ptr<int8_t>(row);
+            float *restored = dequantized.ptr<float>(row);
+            for (int col = 0; col < cols; col++) {
+                int level = cvRound(value[col] / scale[col]);
+                quantized[col] = (int8_t)std::min(std::max(level, -127), 127);
+                restored[col] = quantized[col] * scale[col];
+            }
+        }
+    } else {
+        supportVectors.convertTo(quantizedVectors, CV_16F);
+        quantizedVectors.convertTo(dequantized, CV_32F);
+    }
+    // |x - sv|^2 展开式中的 |sv|^2 也要用量化后的值，否则距离会有系统偏差
+    if (kernelType == SVM::RBF) {
+        // LoadBinary 之后范数指向只读的映射，不能原地写
+        supportVectorNorms.release();
+        cv::reduce(dequantized.mul(dequantized), supportVectorNorms, 1,
+                   cv::REDUCE_SUM, CV_32F);
+        supportVectorNorms = supportVectorNorms.reshape(1, 1);
+    }
+    supportVectors.release();
+    storage = target;
+    return true;
+}
+
+void SVMPredictor::Clear() {
+    storage = VectorStorage::Float32;
+    supportVectors.release();
+    quantizedVectors.release();
+    vectorScales.release();
+    supportVectorNorms.release();
+    rhos.release();
+    functionStarts.release();
+    svIndices.release();
+    alphas.release();
+    weights.release();
+    biases.release();
+    classLabels.clear();
+    mappedFile.reset();
+}
+
+void SVMPredictor::ComputeKernel(const Mat &samples, Mat &kernel) const {
+    if (storage == VectorStorage::Int8) {
+        // 缩放系数乘到样本上，内层只剩 int8 转 float 和乘加
+        Mat scaled = samples.mul(cv::repeat(vectorScales, samples.rows, 1));
+        ComputeQuantizedDot<int8_t>(scaled, quantizedVectors, kernel);
+    } else if (storage == VectorStorage::Float16) {
+        ComputeQuantizedDot<uint16_t>(samples, quantizedVectors, kernel);
+    } else {
+        cv::gemm(samples, supportVectors, 1, cv::noArray(), 0, kernel,
+                 cv::GEMM_2_T);
+    }
+    switch (kernelType) {
+    case SVM::POLY:
+        kernel.convertTo(kernel, CV_32F, gamma, coef0);
+        cv::pow(kernel, degree, kernel);
+        break;
+    case SVM::SIGMOID:
+        // 与 OpenCV 的 calc_sigmoid 一致：它用 -2 * gamma、-2 * coef0 算
+        // (e - 1) / (e + 1)，结果是 -tanh(gamma * x + coef0)
+        for (int row = 0; row < kernel.rows; row++) {
+            float *value = kernel.ptr<float>(row);
+            for (int col = 0; col < kernel.cols; col++) {
+                value[col] = -(float)std::tanh(gamma * value[col] + coef0);
+            }
+        }
+        break;
+    case SVM::RBF: {
+        // |x - sv|^2 = |x|^2 + |sv|^2 - 2 x.sv
+        const float *svNorm = supportVectorNorms.ptr<float>(0);
+        for (int row = 0; row < kernel.rows; row++) {
+            float *value = kernel.ptr<float>(row);
+            const float *sample = samples.ptr<float>(row);
+            float norm = 0;
+            for (int col = 0; col < samples.cols; col++) {
+                norm += sample[col] * sample[col];
+            }
+            for (int col = 0; col < kernel.cols; col++) {
+                float distance = std::max(norm + svNorm[col] - 2 * value[col],
+                                          0.f);
+                value[col] = -(float)gamma * distance;
+            }
+        }
+        cv::exp(kernel, kernel);
+        break;
+    }
+    case SVM::LINEAR:
+    default:
+        break;
+    }
+}
+
+void SVMPredictor::ComputeDecisionValues(const Mat &samples,
+                                         Mat &decisionValues,
+                                         const Mat *allowed) const {
+    // 核矩阵每个线程一份，连续预测时大小不变就不再分配
+    thread_local Mat kernel;
+    if (!weights.empty()) {
+        // 线性核直接用样本，Nyström 近似用样本到地标的核函数
+        if (kernelType != SVM::LINEAR)
+            ComputeKernel(samples, kernel);
+        cv::gemm(kernelType == SVM::LINEAR ? samples : kernel, weights, 1,
+                 cv::noArray(), 0, decisionValues, cv::GEMM_2_T);
+        for (int row = 0; row < decisionValues.rows; row++) {
+            decisionValues.row(row) += biases;
+        }
+        return;
+    }
+
+    ComputeKernel(samples, kernel);
+    int functionCount = (int)rhos.total();
+    const double *rhoValues = rhos.ptr<double>();
+    const int *starts = functionStarts.ptr<int>();
+    const int *indices = svIndices.ptr<int>();
+    const double *alphaValues = alphas.ptr<double>();
+    int classCount = GetClassCount();
+    decisionValues.create(samples.rows, functionCount, CV_32FC1);
+    for (int row = 0; row < samples.rows; row++) {
+        const float *value = kernel.ptr<float>(row);
+        float *decision = decisionValues.ptr<float>(row);
+        const uchar *flags = GetAllowedRow(allowed, row);
+        int index = 0;
+        for (int i = 0; i < classCount; i++) {
+            for (int j = i + 1; j < classCount; j++, index++) {
+                if (flags != nullptr && (flags[i] == 0 || flags[j] == 0)) {
+                    decision[index] = 0;
+                    continue;
+                }
+                double sum = -rhoValues[index];
+                for (int k = starts[index]; k < starts[index + 1]; k++) {
+                    sum += alphaValues[k] * value[indices[k]];
+                }
+                decision[index] = (float)sum;
+            }
+        }
+    }
+}
+
+void SVMPredictor::Predict(const Mat &samples, vector<int> &labels,
+                           Mat *decisionValues) const {
+    CV_Assert(IsCompiled());
+    CV_Assert(samples.type() == CV_32FC1 && samples.cols == GetVarCount());
+    labels.resize(samples.rows);
+    if (samples.rows == 0)
+        return;
+    // 调用者要决策值时单独分配，否则用线程自己的缓冲
+    thread_local Mat scratch;
+    if (decisionValues != nullptr)
+        decisionValues->release();
+    Mat &decisions = decisionValues != nullptr ? *decisionValues : scratch;
+    ComputeDecisionValues(samples, decisions);
+    Vote(decisions, nullptr, labels);
+}
+
+void SVMPredictor::Predict(const Mat &samples, const Mat &allowed,
+                           vector<int> &labels) const {
+    CV_Assert(IsCompiled());
+    CV_Assert(samples.type() == CV_32FC1 && samples.cols == GetVarCount());
+    CV_Assert(allowed.type() == CV_8UC1 && allowed.rows == samples.rows &&
+              allowed.cols == GetClassCount());
+    labels.resize(samples.rows);
+    if (samples.rows == 0)
+        return;
+    thread_local Mat decisions;
+    ComputeDecisionValues(samples, decisions, &allowed);
+    Vote(decisions, &allowed, labels);
+}
+
+void SVMPredictor::Vote(const Mat &decisionValues, const Mat *allowed,
+                        vector<int> &labels) const {
+    int classCount = GetClassCount();
+    thread_local vector<int> votes;
+    votes.resize(classCount);
+    for (int row = 0; row < decisionValues.rows; row++) {
+        const float *decision = decisionValues.ptr<float>(row);
+        const uchar *flags = GetAllowedRow(allowed, row);
+        std::fill(votes.begin(), votes.end(), 0);
+        int index = 0;
+        for (int i = 0; i < classCount; i++) {
+            for (int j = i + 1; j < classCount; j++, index++) {
+                if (flags != nullptr && (flags[i] == 0 || flags[j] == 0))
+                    continue;
+                votes[decision[index] > 0 ? i : j]++;
+            }
+        }
+        // 票数相同取靠前的类别，限制类别时只在允许的类别中选
+        int winner = -1;
+        for (int i = 0; i < classCount; i++) {
+            if (flags != nullptr && flags[i] == 0)
+                continue;
+            if (winner < 0 || votes[i] > votes[winner])
+                winner = i;
+        }
+        labels[row] = classLabels[winner];
+    }
+}
+
+bool SVMPredictor::IsBinaryModel(const string &fileName) {
+    std::ifstream file(fileName, std::ios::binary);
+    char magic[sizeof(BinaryMagic)] = {};
+    file.read(magic, sizeof(magic));
+    return file && std::memcmp(magic, BinaryMagic, sizeof(magic)) == 0;
+}
+
+void SVMPredictor::SaveBinary(const string &fileName,
+                              const HogParameters &hog) const {
+    if (!IsCompiled())
+        throw logic_error("svm predictor is not compiled");
+
+    BinaryHeader header = {};
+    std::memcpy(header.Magic, BinaryMagic, sizeof(BinaryMagic));
+    header.Version = BinaryVersion;
+    header.ByteOrder = ByteOrderMark;
+    header.KernelType = kernelType;
+    header.VectorStorage = (int32_t)storage;
+    header.ClassCount = GetClassCount();
+    header.FunctionCount = (int32_t)rhos.total();
+    header.VarCount = GetVarCount();
+    header.VectorCount = GetSupportVectorCount();
+    header.AlphaCount = (int32_t)alphas.total();
+    header.WeightCols = weights.cols;
+    int32_t hogValues[9] = {hog.WinSize.width,     hog.WinSize.height,
+                            hog.BlockSize.width,   hog.BlockSize.height,
+                            hog.BlockStride.width, hog.BlockStride.height,
+                            hog.CellSize.width,    hog.CellSize.height,
+                            hog.NBins};
+    std::memcpy(header.Hog, hogValues, sizeof(hogValues));
+    header.Gamma = gamma;
+    header.Coef0 = coef0;
+    header.Degree = degree;
+
+    Mat sections[SectionCount] = {
+        Mat(classLabels, true), GetVectors(), supportVectorNorms,
+        rhos,                   functionStarts, svIndices,
+        alphas,                 weights,        biases,
+        vectorScales};
+    uint64_t offset = AlignSection(sizeof(BinaryHeader));
+    for (int index = 0; index < SectionCount; index++) {
+        if (sections[index].empty())
+            continue;
+        if (!sections[index].isContinuous())
+            sections[index] = sections[index].clone();
+        header.SectionOffsets[index] = offset;
+        header.SectionSizes[index] =
+            sections[index].total() * sections[index].elemSize();
+        offset = AlignSection(offset + header.SectionSizes[index]);
+    }
+
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    file.write((const char *)&header, sizeof(header));
+    uint64_t position = sizeof(header);
+    const char padding[SectionAlignment] = {};
+    for (int index = 0; index < SectionCount; index++) {
+        if (header.SectionSizes[index] == 0)
+            continue;
+        file.write(padding, header.SectionOffsets[index] - position);
+        file.write((const char *)sections[index].data,
+                   header.SectionSizes[index]);
+        position = header.SectionOffsets[index] + header.SectionSizes[index];
+    }
+    if (!file)
+        throw logic_error("cannot write " + fileName);
+}
+
+void SVMPredictor::LoadBinary(const string &fileName, HogParameters &hog) {
+    auto file = std::make_shared<MappedFile>(fileName);
+    BinaryHeader header;
+    if (file->Size() < sizeof(header))
+        throw logic_error("truncated svm model " + fileName);
+    std::memcpy(&header, file->Data(), sizeof(header));
+    if (std::memcmp(header.Magic, BinaryMagic, sizeof(BinaryMagic)) != 0 ||
+        header.Version != BinaryVersion || header.ByteOrder != ByteOrderMark)
+        throw logic_error("unsupported svm model " + fileName);
+
+    // 各个数组的长度必须与文件头中的个数一致，否则认为文件损坏
+    int classCount = header.ClassCount;
+    int functionCount = header.FunctionCount;
+    bool hasWeights = header.SectionSizes[WeightsSection] != 0;
+    VectorStorage vectorStorage = (VectorStorage)header.VectorStorage;
+    int vectorType = vectorStorage == VectorStorage::Int8      ? CV_8SC1
+                     : vectorStorage == VectorStorage::Float16 ? CV_16FC1
+                                                               : CV_32FC1;
+    uint64_t expectedSizes[SectionCount] = {
+        (uint64_t)classCount * sizeof(int32_t),
+        (uint64_t)header.VectorCount * header.VarCount *
+            CV_ELEM_SIZE(vectorType),
+        (uint64_t)header.VectorCount * sizeof(float),
+        (uint64_t)functionCount * sizeof(double),
+        (uint64_t)(functionCount + 1) * sizeof(int32_t),
+        (uint64_t)header.AlphaCount * sizeof(int32_t),
+        (uint64_t)header.AlphaCount * sizeof(double),
+        (uint64_t)functionCount * header.WeightCols * sizeof(float),
+        (uint64_t)functionCount * sizeof(float),
+        (uint64_t)header.VarCount * sizeof(float)};
+    // 类别数很大时 classCount * (classCount - 1) 会超出 int
+    bool valid = header.VectorStorage >= 0 && header.VectorStorage <= 2 &&
+                 (header.KernelType == SVM::LINEAR ||
+                  header.KernelType == SVM::POLY ||
+                  header.KernelType == SVM::RBF ||
+                  header.KernelType == SVM::SIGMOID) &&
+                 classCount >= 2 && header.VectorCount > 0 &&
+                 header.VarCount > 0 && header.AlphaCount >= 0 &&
+                 header.WeightCols >= 0 &&
+                 (int64_t)functionCount ==
+                     (int64_t)classCount * (classCount - 1) / 2;
+    for (int index = 0; valid && index < SectionCount; index++) {
+        uint64_t size = header.SectionSizes[index];
+        uint64_t offset = header.SectionOffsets[index];
+        // 范数只有 RBF 核需要；合并成权重矩阵后不再需要一对一决策函数
+        bool optional = index == NormsSection ||
+                        (hasWeights && (index == FunctionStartsSection ||
+                                        index == SVIndicesSection ||
+                                        index == AlphasSection)) ||
+                        (!hasWeights && index == BiasesSection) ||
+                        (vectorStorage != VectorStorage::Int8 &&
+                         index == ScalesSection);
+        if (size == 0 && (optional || expectedSizes[index] == 0))
+            continue;
+        valid = size == expectedSizes[index] &&
+                offset % SectionAlignment == 0 &&
+                offset >= sizeof(header) && offset <= file->Size() &&
+                size <= file->Size() - offset;
+    }
+    if (valid && header.KernelType == SVM::RBF)
+        valid = header.SectionSizes[NormsSection] != 0;
+    // 线性核的权重是样本上的，Nyström 近似的权重是地标上的
+    if (valid && hasWeights)
+        valid = header.SectionSizes[BiasesSection] != 0 &&
+                header.WeightCols == (header.KernelType == SVM::LINEAR
+                                          ? header.VarCount
+                                          : header.VectorCount);
+    if (valid && vectorStorage == VectorStorage::Int8)
+        valid = header.SectionSizes[ScalesSection] != 0;
+    if (valid && !hasWeights)
+        valid = header.SectionSizes[FunctionStartsSection] != 0;
+    if (!valid)
+        throw logic_error("corrupted svm model " + fileName);
+
+    // 映射是只读的（PROT_READ / FILE_MAP_READ），Mat 只能读，写入会访问违例。
+    // 这些矩阵只留在成员中，Quantize 等修改时都换成新分配的矩阵
+    auto section = [&](BinarySection index, int rows, int cols, int type) {
+        if (header.SectionSizes[index] == 0)
+            return Mat();
+        return Mat(rows, cols, type,
+                   (void *)(file->Data() + header.SectionOffsets[index]));
+    };
+    Mat labels = section(LabelsSection, 1, classCount, CV_32SC1);
+    Mat starts = section(FunctionStartsSection, 1, functionCount + 1, CV_32SC1);
+    Mat indices = section(SVIndicesSection, 1, header.AlphaCount, CV_32SC1);
+    // 一对一决策函数的下标越界会在预测时读到映射之外
+    if (!starts.empty()) {
+        const int *startValues = starts.ptr<int>();
+        bool ordered = startValues[0] == 0 &&
+                       startValues[functionCount] == header.AlphaCount;
+        for (int index = 0; ordered && index < functionCount; index++) {
+            ordered = startValues[index] <= startValues[index + 1];
+        }
+        const int *indexValues = indices.empty() ? nullptr : indices.ptr<int>();
+        for (int k = 0; ordered && k < header.AlphaCount; k++) {
+            ordered = (unsigned)indexValues[k] < (unsigned)header.VectorCount;
+        }
+        if (!ordered)
+            throw logic_error("corrupted svm model " + fileName);
+    }
+
+    Clear();
+    kernelType = header.KernelType;
+    gamma = header.Gamma;
+    coef0 = header.Coef0;
+    degree = header.Degree;
+    storage = vectorStorage;
+    Mat vectors =
+        section(VectorsSection, header.VectorCount, header.VarCount, vectorType);
+    if (storage == VectorStorage::Float32)
+        supportVectors = vectors;
+    else
+        quantizedVectors = vectors;
+    vectorScales = section(ScalesSection, 1, header.VarCount, CV_32FC1);
+    supportVectorNorms =
+        section(NormsSection, 1, header.VectorCount, CV_32FC1);
+    rhos = section(RhosSection, 1, functionCount, CV_64FC1);
+    functionStarts = starts;
+    svIndices = indices;
+    alphas = section(AlphasSection, 1, header.AlphaCount, CV_64FC1);
+    weights = section(WeightsSection, functionCount, header.WeightCols,
+                      CV_32FC1);
+    biases = section(BiasesSection, 1, functionCount, CV_32FC1);
+    classLabels.assign(labels.ptr<int>(), labels.ptr<int>() + classCount);
+    mappedFile = file;
+
+    hog.WinSize = cv::Size(header.Hog[0], header.Hog[1]);
+    hog.BlockSize = cv::Size(header.Hog[2], header.Hog[3]);
+    hog.BlockStride = cv::Size(header.Hog[4], header.Hog[5]);
+    hog.CellSize = cv::Size(header.Hog[6], header.Hog[7]);
+    hog.NBins = header.Hog[8];
+}
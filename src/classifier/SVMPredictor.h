@@ -0,0 +1,170 @@
+#ifndef SVM_PREDICTOR_H
+#define SVM_PREDICTOR_H
+
+#include <opencv2/core.hpp>
+#include <opencv2/ml.hpp>
+using cv::Mat;
+using cv::Ptr;
+using cv::ml::SVM;
+
+#include <memory>
+using std::shared_ptr;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+namespace Doit {
+namespace CV {
+namespace PlateRecogn {
+
+class MappedFile;
+
+// 与模型一起保存到二进制文件里的 HOG 参数，加载时用来确认特征一致
+struct HogParameters {
+    cv::Size WinSize;
+    cv::Size BlockSize;
+    cv::Size BlockStride;
+    cv::Size CellSize;
+    int NBins = 0;
+
+    bool operator==(const HogParameters &other) const {
+        return WinSize == other.WinSize && BlockSize == other.BlockSize &&
+               BlockStride == other.BlockStride &&
+               CellSize == other.CellSize && NBins == other.NBins;
+    }
+    bool operator!=(const HogParameters &other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * 把训练好的 C_SVC 模型展开成支持向量矩阵和一对一决策函数，批量预测时
+ * 所有样本和所有支持向量的核函数用一次矩阵乘法算出来。
+ *
+ * 投票规则与 SVM::predict 相同（决策值大于 0 投给前一个类别，票数相同取
+ * 靠前的类别），核函数换成矩阵乘法后只有浮点舍入上的差别，决策值非常接近
+ * 0 的样本才可能和 SVM::predict 的结果不同。
+ *
+ * 线性核的每个一对一决策函数合并成一个权重向量，预测时只需要一次
+ * samples x 权重矩阵转置 的乘法。
+ *
+ * RBF 核可以用 CompileNystrom 换成 Nyström 近似：从支持向量中取固定个数的
+ * 地标，K(x, sv) 近似为 k(x, L) K_LL^+ k(L, sv)，于是每个决策函数都合并成
+ * 地标上的一个权重向量。预测只需要算样本到地标的核函数，再乘一次权重矩阵，
+ * 耗时约为 地标数 x (维数 + 类别对数)，精确计算约为
+ * 支持向量数 x (维数 + 类别数 - 1)，地标数要比支持向量数少得多才划算。
+ *
+ * 非线性核的支持向量可以用 Quantize 换成 int8（每一维一个缩放系数）或
+ * fp16 存放，核函数中的点积由 QuantizedKernel 一边读一边转换，支持向量
+ * 矩阵的内存和带宽降到 1/4 或 1/2；样本仍是 float。RBF 的支持向量范数按
+ * 量化后的值重新计算，结果与用量化后的支持向量精确计算只差浮点舍入。
+ *
+ * 展开后的模型可以用 SaveBinary 存成二进制文件：文件头之后是按 64 字节
+ * 对齐的各个数组，本机字节序。LoadBinary 只检查文件头，矩阵直接指向内存
+ * 映射的文件，不需要解析也不复制。
+ *
+ * Compile 之后只有 const 成员函数，可以被多个线程同时调用。
+ */
+class SVMPredictor {
+  public:
+    // 支持向量的存放方式，数值与二进制文件中的一致
+    enum class VectorStorage { Float32 = 0, Int8 = 1, Float16 = 2 };
+
+    // 只支持 C_SVC 和 LINEAR / POLY / RBF / SIGMOID 核，其他模型返回 false，
+    // 调用者应继续使用 SVM::predict
+    bool Compile(const Ptr<SVM> &svm);
+    // RBF 核的 Nyström 近似，landmarkCount 个地标。不是 RBF 核或地标数不少于
+    // 支持向量数时返回 false，此时如果 Compile 成功仍保留精确模型
+    bool CompileNystrom(const Ptr<SVM> &svm, int landmarkCount);
+    // 在 Compile / CompileNystrom / LoadBinary 之后调用。线性核已经合并成
+    // 权重矩阵、或者已经量化过时返回 false
+    bool Quantize(VectorStorage target);
+    void Clear();
+    bool IsCompiled() const { return !classLabels.empty(); }
+    bool IsLinear() const {
+        return kernelType == SVM::LINEAR && !weights.empty();
+    }
+    bool IsApproximate() const {
+        return kernelType != SVM::LINEAR && !weights.empty();
+    }
+
+    int GetClassCount() const { return (int)classLabels.size(); }
+    // 类别标签按一对一决策函数的类别顺序排列
+    const vector<int> &GetClassLabels() const { return classLabels; }
+    int GetVarCount() const { return GetVectors().cols; }
+    // 精确模型的支持向量数，Nyström 近似时是地标数
+    int GetSupportVectorCount() const { return GetVectors().rows; }
+    VectorStorage GetVectorStorage() const { return storage; }
+    // 支持向量（或地标）矩阵占用的字节数
+    size_t GetVectorBytes() const {
+        return GetVectors().total() * GetVectors().elemSize();
+    }
+
+    // samples 每行一个样本（CV_32FC1）。labels[i] 是第 i 行的类别标签；
+    // decisionValues 不为空时输出 samples.rows x 类别对数 的 CV_32FC1，
+    // 类别对按 (0,1), (0,2) ... (1,2) ... 的顺序，大于 0 表示投给前一个类别
+    void Predict(const Mat &samples, vector<int> &labels,
+                 Mat *decisionValues = nullptr) const;
+    // allowed 是 samples.rows x 类别数 的 CV_8UC1，列的顺序与 GetClassLabels
+    // 相同，非 0 表示该样本可以是这个类别。只有两个类别都允许的决策函数
+    // 参与投票（非线性核时其他决策函数不计算）；一行全为 0 时不限制
+    void Predict(const Mat &samples, const Mat &allowed,
+                 vector<int> &labels) const;
+
+    // 文件开头是否是 SaveBinary 写出的标记
+    static bool IsBinaryModel(const string &fileName);
+    // 未展开时抛出 logic_error
+    void SaveBinary(const string &fileName, const HogParameters &hog) const;
+    // 文件格式不对时抛出 logic_error，hog 输出文件中保存的 HOG 参数
+    void LoadBinary(const string &fileName, HogParameters &hog);
+
+  private:
+    // 所有样本对所有支持向量的核函数值，samples.rows x 支持向量个数
+    void ComputeKernel(const Mat &samples, Mat &kernel) const;
+    const Mat &GetVectors() const {
+        return storage == VectorStorage::Float32 ? supportVectors
+                                                 : quantizedVectors;
+    }
+    // samples.rows x 类别对数 的决策值 (CV_32FC1)。allowed 不为空时跳过
+    // 不需要的一对一决策函数，对应的决策值为 0
+    void ComputeDecisionValues(const Mat &samples, Mat &decisionValues,
+                               const Mat *allowed = nullptr) const;
+    // 按 decisionValues 投票，allowed 的含义同 Predict
+    void Vote(const Mat &decisionValues, const Mat *allowed,
+              vector<int> &labels) const;
+
+    int kernelType = SVM::KernelTypes::LINEAR;
+    double gamma = 1;
+    double coef0 = 0;
+    double degree = 1;
+    // 量化后 supportVectors 为空，改用 quantizedVectors (CV_8SC1 / CV_16FC1)，
+    // int8 时第 d 维的值是 quantizedVectors(i, d) * vectorScales(d)
+    VectorStorage storage = VectorStorage::Float32;
+    Mat supportVectors;
+    Mat quantizedVectors;
+    Mat vectorScales;
+    // RBF 核用到的每个支持向量的平方和，1 x 支持向量个数
+    Mat supportVectorNorms;
+    // 一对一决策函数 i 的 rho 是 rhos[i]，用到的支持向量下标和 alpha 是
+    // svIndices / alphas 中 [functionStarts[i], functionStarts[i + 1]) 的部分。
+    // 合并成权重矩阵后不再需要
+    Mat rhos;
+    Mat functionStarts;
+    Mat svIndices;
+    Mat alphas;
+    // 线性核：每个决策函数一行 sum(alpha * sv)；Nyström 近似：每个决策函数
+    // 一行地标上的权重。以及 1 x 类别对数 的 -rho
+    Mat weights;
+    Mat biases;
+    vector<int> classLabels;
+    // LoadBinary 之后上面的矩阵指向这个只读映射，不能写入，也不能交给
+    // 调用者；需要修改时先 release 再重新分配
+    shared_ptr<MappedFile> mappedFile;
+};
+
+} // namespace PlateRecogn
+} // namespace CV
+} // namespace Doit
+
+#endif // !SVM_PREDICTOR_H
@@ -0,0 +1,130 @@
+#include "StageTimer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+using std::ostringstream;
+
+using namespace Doit::CV::PlateRecogn;
+
+void StageHistogram::Add(long long nanoseconds) {
+    if (nanoseconds < 0)
+        nanoseconds = 0;
+    buckets[GetBucket((unsigned long long)nanoseconds)].fetch_add(
+        1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sumNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    long long max = maxNanoseconds.load(std::memory_order_relaxed);
+    while (nanoseconds > max &&
+           !maxNanoseconds.compare_exchange_weak(max, nanoseconds,
+                                                 std::memory_order_relaxed)) {
+    }
+}
+
+void StageHistogram::Reset() {
+    for (auto &bucket : buckets) {
+        bucket = 0;
+    }
+    count = 0;
+    sumNanoseconds = 0;
+    maxNanoseconds = 0;
+}
+
+double StageHistogram::GetMeanMicroseconds() const {
+    size_t total = count;
+    if (total == 0)
+        return 0;
+    return sumNanoseconds / 1000.0 / total;
+}
+
+double StageHistogram::GetPercentileMicroseconds(double percentile) const {
+    // 其他线程可能同时在 Add，这里只需要一个大致的结果
+    size_t total = 0;
+    unsigned counts[BucketCount];
+    for (size_t bucket = 0; bucket < BucketCount; bucket++) {
+        counts[bucket] = buckets[bucket];
+        total += counts[bucket];
+    }
+    if (total == 0)
+        return 0;
+    percentile = std::min(std::max(percentile, 0.0), 1.0);
+    // 第 rank 个（从 1 开始）记录所在的桶
+    size_t rank = std::max<size_t>((size_t)(percentile * total + 0.5), 1);
+    size_t seen = 0;
+    for (size_t bucket = 0; bucket < BucketCount; bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank)
+            return std::min(GetBucketMiddle(bucket), GetMaxMicroseconds());
+    }
+    return GetMaxMicroseconds();
+}
+
+// [0, 8) 每个值一个桶，之后 [2^e, 2^(e+1)) 按高 3 位分成 8 个桶
+size_t StageHistogram::GetBucket(unsigned long long nanoseconds) {
+    if (nanoseconds < (unsigned long long)SubBucketCount)
+        return (size_t)nanoseconds;
+    int exponent = 0;
+    for (unsigned long long value = nanoseconds; value > 1; value >>= 1) {
+        exponent++;
+    }
+    if (exponent > MaxExponent)
+        return BucketCount - 1;
+    size_t subBucket =
+        (size_t)(nanoseconds >> (exponent - SubBucketBits)) & (SubBucketCount - 1);
+    return (size_t)(exponent - SubBucketBits + 1) * SubBucketCount + subBucket;
+}
+
+double StageHistogram::GetBucketMiddle(size_t bucket) {
+    if (bucket < (size_t)SubBucketCount)
+        return bucket / 1000.0;
+    int exponent = (int)(bucket / SubBucketCount) - 1 + SubBucketBits;
+    size_t subBucket = bucket % SubBucketCount;
+    double width = (double)(1ull << (exponent - SubBucketBits));
+    double lower = (SubBucketCount + subBucket) * width;
+    return (lower + width / 2) / 1000.0;
+}
+
+void StageStatistics::Add(const StageTimes &times) {
+    for (size_t index = 0; index < PipelineStageCount; index++) {
+        PipelineStage_t stage = (PipelineStage_t)index;
+        if (times.HasStage(stage))
+            histograms[index].Add(times.GetNanoseconds(stage));
+    }
+}
+
+void StageStatistics::Reset() {
+    for (auto &histogram : histograms) {
+        histogram.Reset();
+    }
+}
+
+string StageStatistics::ToJson() const {
+    ostringstream buffer;
+    buffer << std::fixed << std::setprecision(1);
+    buffer << "{\"enabled\": " << (StageTimingEnabled ? "true" : "false")
+           << ", \"stages\": {";
+    bool first = true;
+    for (size_t index = 0; index < PipelineStageCount; index++) {
+        const StageHistogram &histogram = histograms[index];
+        if (histogram.GetCount() == 0)
+            continue;
+        if (!first)
+            buffer << ", ";
+        first = false;
+        buffer << "\"" << PipelineStage_tToString[index] << "\": {"
+               << "\"count\": " << histogram.GetCount()
+               << ", \"mean_us\": " << histogram.GetMeanMicroseconds()
+               << ", \"p50_us\": " << histogram.GetPercentileMicroseconds(0.50)
+               << ", \"p95_us\": " << histogram.GetPercentileMicroseconds(0.95)
+               << ", \"p99_us\": " << histogram.GetPercentileMicroseconds(0.99)
+               << ", \"max_us\": " << histogram.GetMaxMicroseconds() << "}";
+    }
+    buffer << "}}";
+    return buffer.str();
+}
+
+void StageStatistics::SaveJson(const string &fileName) const {
+    std::ofstream file(fileName);
+    file << ToJson() << std::endl;
+}
@@ -0,0 +1,247 @@
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+using std::string;
+
+namespace Doit {
+namespace CV {
+namespace PlateRecogn {
+
+// 定义 PLATE_STAGE_TIMING 时记录识别流程各阶段的耗时，否则 StageTimer 等
+// 都是空的内联类，不读时钟也不访问线程局部变量
+#ifdef PLATE_STAGE_TIMING
+constexpr bool StageTimingEnabled = true;
+#else
+constexpr bool StageTimingEnabled = false;
+#endif
+
+enum class PipelineStage_t {
+    LocateColor = 0,
+    LocateSobel,
+    CategorySVM,
+    SplitOrigin,
+    SplitGamma,
+    SplitExponential,
+    SplitLog,
+    // 字符的 HOG 特征，车牌分类的 HOG 算在 CategorySVM 里
+    Hog,
+    CharSVM,
+    // 切分、识别之后对字符的修正（版式裁剪、补汉字等）
+    PostProcess,
+    // 整个 Recognite，包含上面所有阶段
+    Recognite
+};
+constexpr const char *PipelineStage_tToString[] = {
+    "LocateColor", "LocateSobel",      "CategorySVM", "SplitOrigin",
+    "SplitGamma",  "SplitExponential", "SplitLog",    "Hog",
+    "CharSVM",     "PostProcess",      "Recognite"};
+constexpr size_t PipelineStageCount =
+    sizeof(PipelineStage_tToString) / sizeof(PipelineStage_tToString[0]);
+
+/**
+ * 一次 Recognite 中各阶段的耗时总和。任务池中的线程会同时累加，
+ * 所以并行时各阶段之和可能大于 Recognite 的耗时。
+ */
+class StageTimes {
+  public:
+    void Add(PipelineStage_t stage, long long nanoseconds) {
+        nanosecondsByStage[(size_t)stage].fetch_add(nanoseconds,
+                                                    std::memory_order_relaxed);
+        hits[(size_t)stage].fetch_add(1, std::memory_order_relaxed);
+    }
+    long long GetNanoseconds(PipelineStage_t stage) const {
+        return nanosecondsByStage[(size_t)stage];
+    }
+    // 这次调用是否经过了 stage
+    bool HasStage(PipelineStage_t stage) const {
+        return hits[(size_t)stage] > 0;
+    }
+
+    // 当前线程的计时写到哪个 StageTimes，没有时为 nullptr
+    static StageTimes *Current() {
+#ifdef PLATE_STAGE_TIMING
+        return current;
+#else
+        return nullptr;
+#endif
+    }
+
+  private:
+    friend class StageTimesScope;
+
+    std::atomic<long long> nanosecondsByStage[PipelineStageCount] = {};
+    std::atomic<unsigned> hits[PipelineStageCount] = {};
+#ifdef PLATE_STAGE_TIMING
+    static inline thread_local StageTimes *current = nullptr;
+#endif
+};
+
+/**
+ * 对数分桶的耗时直方图，每个 2 的幂区间分 8 个桶，百分位数取桶的中点，
+ * 相对误差不超过 1/16。Add 可以被多个线程同时调用。
+ */
+class StageHistogram {
+  public:
+    void Add(long long nanoseconds);
+    void Reset();
+
+    size_t GetCount() const { return count; }
+    double GetMeanMicroseconds() const;
+    double GetMaxMicroseconds() const { return maxNanoseconds / 1000.0; }
+    // percentile 取 [0, 1]，没有记录时返回 0
+    double GetPercentileMicroseconds(double percentile) const;
+
+  private:
+    static const int SubBucketBits = 3;
+    static const int SubBucketCount = 1 << SubBucketBits;
+    // 超过 2^40 ns（约 18 分钟）的都放进最后一个桶
+    static const int MaxExponent = 39;
+    static const size_t BucketCount =
+        (MaxExponent - SubBucketBits + 2) * SubBucketCount;
+
+    static size_t GetBucket(unsigned long long nanoseconds);
+    static double GetBucketMiddle(size_t bucket);
+
+    std::atomic<unsigned> buckets[BucketCount] = {};
+    std::atomic<size_t> count{0};
+    std::atomic<long long> sumNanoseconds{0};
+    std::atomic<long long> maxNanoseconds{0};
+};
+
+/**
+ * 多次 Recognite 的各阶段耗时，每个阶段一个直方图。某次调用没有经过的阶段
+ * （例如颜色法已经找到车牌时的 LocateSobel）不计入该阶段的直方图。
+ */
+class StageStatistics {
+  public:
+    void Add(const StageTimes &times);
+    void Reset();
+
+    const StageHistogram &Get(PipelineStage_t stage) const {
+        return histograms[(size_t)stage];
+    }
+
+    // {"enabled": true, "stages": {"LocateColor": {"count": 10,
+    // "mean_us": 1.5, "p50_us": ..., "p95_us": ..., "p99_us": ...,
+    // "max_us": ...}, ...}}，没有记录的阶段不输出
+    string ToJson() const;
+    void SaveJson(const string &fileName) const;
+
+  private:
+    StageHistogram histograms[PipelineStageCount];
+};
+
+#ifdef PLATE_STAGE_TIMING
+/**
+ * 在当前线程上把计时写到 times，析构时恢复原来的。任务池用它把调用线程的
+ * StageTimes 带到执行任务的线程上。
+ */
+class StageTimesScope {
+  public:
+    explicit StageTimesScope(StageTimes *times)
+        : previous(StageTimes::current) {
+        StageTimes::current = times;
+    }
+    ~StageTimesScope() { StageTimes::current = previous; }
+
+    StageTimesScope(const StageTimesScope &) = delete;
+    StageTimesScope &operator=(const StageTimesScope &) = delete;
+
+  private:
+    StageTimes *previous;
+};
+
+/**
+ * 一次 Recognite 的计时：构造时开始记录，析构时把各阶段耗时和总耗时
+ * 加到 statistics。
+ */
+class StageRecording {
+  public:
+    explicit StageRecording(StageStatistics &statistics)
+        : statistics(statistics), scope(&times),
+          start(std::chrono::steady_clock::now()) {}
+    ~StageRecording() {
+        times.Add(PipelineStage_t::Recognite,
+                  std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count());
+        statistics.Add(times);
+    }
+
+  private:
+    StageStatistics &statistics;
+    StageTimes times;
+    StageTimesScope scope;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * 一个阶段的计时范围。计的是本阶段自己的时间：同一线程上嵌套的 StageTimer
+ * 运行期间外层暂停，例如 LocateColor 中调用的 CategorySVM 只算在
+ * CategorySVM 里。ParallelFor 中调用线程等待其他线程的时间算在外层阶段。
+ * 当前线程没有 StageTimes 时（例如训练）不读时钟。
+ */
+class StageTimer {
+  public:
+    explicit StageTimer(PipelineStage_t stage)
+        : times(StageTimes::Current()), stage(stage) {
+        if (times == nullptr)
+            return;
+        parent = active;
+        start = Clock::now();
+        if (parent != nullptr)
+            parent->elapsed += start - parent->start;
+        active = this;
+    }
+    ~StageTimer() {
+        if (times == nullptr)
+            return;
+        Clock::time_point stop = Clock::now();
+        elapsed += stop - start;
+        times->Add(
+            stage,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count());
+        active = parent;
+        if (parent != nullptr)
+            parent->start = stop;
+    }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    StageTimes *times;
+    PipelineStage_t stage;
+    StageTimer *parent = nullptr;
+    Clock::time_point start;
+    Clock::duration elapsed{0};
+    static inline thread_local StageTimer *active = nullptr;
+};
+#else
+class StageTimesScope {
+  public:
+    explicit StageTimesScope(StageTimes *) {}
+};
+
+class StageRecording {
+  public:
+    explicit StageRecording(StageStatistics &) {}
+};
+
+class StageTimer {
+  public:
+    explicit StageTimer(PipelineStage_t) {}
+};
+#endif // PLATE_STAGE_TIMING
+
+} // namespace PlateRecogn
+} // namespace CV
+} // namespace Doit
+
+#endif // !STAGE_TIMER_H
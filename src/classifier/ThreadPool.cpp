@@ -0,0 +1,108 @@
+#include "ThreadPool.h"
+#include "StageTimer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+using namespace Doit::CV::PlateRecogn;
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        size_t hardwareCount = thread::hardware_concurrency();
+        threadCount = hardwareCount > 1 ? hardwareCount - 1 : 0;
+    }
+    for (size_t index = 0; index < threadCount; index++) {
+        threads.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<mutex> lock(tasksMutex);
+        stopping = true;
+    }
+    tasksCondition.notify_all();
+    for (auto &worker : threads) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Enqueue(function<void()> task) {
+    {
+        std::lock_guard<mutex> lock(tasksMutex);
+        tasks.push(std::move(task));
+    }
+    tasksCondition.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        function<void()> task;
+        {
+            std::unique_lock<mutex> lock(tasksMutex);
+            tasksCondition.wait(lock,
+                                [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(
+    size_t count, const function<void(size_t index, size_t worker)> &body) {
+    if (count == 0)
+        return;
+    size_t helperCount = std::min(threads.size(), count - 1);
+    if (helperCount == 0) {
+        for (size_t index = 0; index < count; index++) {
+            body(index, 0);
+        }
+        return;
+    }
+
+    struct State {
+        std::atomic<size_t> next{0};
+        size_t done = 0;
+        std::exception_ptr exception;
+        mutex doneMutex;
+        std::condition_variable doneCondition;
+    };
+    auto state = std::make_shared<State>();
+    // 任务的耗时记到调用线程正在记录的 StageTimes 里
+    StageTimes *times = StageTimes::Current();
+
+    // 帮手线程可能在所有 index 都被领走之后才开始运行，这时它不会再访问 body，
+    // 而 ParallelFor 一直等到每个被领走的 index 都执行完才返回
+    auto run = [state, count, times, &body](size_t worker) {
+        StageTimesScope timing(times);
+        size_t index;
+        while ((index = state->next.fetch_add(1)) < count) {
+            std::exception_ptr exception;
+            try {
+                body(index, worker);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            std::lock_guard<mutex> lock(state->doneMutex);
+            if (exception && !state->exception)
+                state->exception = exception;
+            if (++state->done == count)
+                state->doneCondition.notify_all();
+        }
+    };
+
+    for (size_t worker = 1; worker <= helperCount; worker++) {
+        Enqueue([run, worker]() { run(worker); });
+    }
+    run(0);
+
+    std::unique_lock<mutex> lock(state->doneMutex);
+    state->doneCondition.wait(lock, [&]() { return state->done == count; });
+    if (state->exception)
+        std::rethrow_exception(state->exception);
+}
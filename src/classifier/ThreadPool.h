@@ -0,0 +1,60 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+using std::function;
+#include <mutex>
+using std::mutex;
+#include <queue>
+using std::queue;
+#include <thread>
+using std::thread;
+#include <vector>
+using std::vector;
+
+namespace Doit {
+namespace CV {
+namespace PlateRecogn {
+
+/**
+ * 固定线程数的任务池。
+ *
+ * ParallelFor 的调用线程自己也参与执行，没有空闲线程时任务就在调用线程上
+ * 跑完，所以在池里的任务中再嵌套调用 ParallelFor 也不会死锁。
+ */
+class ThreadPool {
+  public:
+    // threadCount 为 0 时使用 hardware_concurrency() - 1 个线程（调用线程算一个）
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // 池中的线程数，不包含调用线程
+    size_t Size() const { return threads.size(); }
+
+    // 并发执行 body(index, worker)，index 取遍 [0, count)，全部完成后返回。
+    // worker 是参与这一次调用的线程编号，范围 [0, min(Size(), count - 1)]，
+    // 0 是调用线程，可以用来索引每个线程自己的缓冲区。
+    // body 抛出的第一个异常会在调用线程重新抛出。
+    void ParallelFor(size_t count,
+                     const function<void(size_t index, size_t worker)> &body);
+
+  private:
+    void Enqueue(function<void()> task);
+    void WorkerLoop();
+
+    vector<thread> threads;
+    queue<function<void()>> tasks;
+    mutex tasksMutex;
+    std::condition_variable tasksCondition;
+    bool stopping = false;
+};
+
+} // namespace PlateRecogn
+} // namespace CV
+} // namespace Doit
+
+#endif // !THREAD_POOL_H
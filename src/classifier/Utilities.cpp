@@ -8,7 +8,59 @@ using std::vector;
 
 using namespace Doit::CV::PlateRecogn;
 
+namespace {
+// 三种变换都是像素值的单调函数，两次 NORM_MINMAX 用到的最小、最大值只取决于
+// 图像中的最小、最大值。所以把 [min, max] 排成一行交给浮点实现，得到的就是
+// 每个值在整幅图上的结果，浮点实现中 SIMD 与标量尾部的舍入差异最多差 1
+template <typename Transform>
+cv::Mat TransformByLookupTable(cv::Mat &originalMat, Transform transform) {
+    double minValue = 0, maxValue = 0;
+    cv::minMaxIdx(originalMat, &minValue, &maxValue);
+    int low = (int)minValue, high = (int)maxValue;
+
+    cv::Mat values(1, high - low + 1, CV_8UC1);
+    for (int value = low; value <= high; value++) {
+        values.at<uchar>(0, value - low) = (uchar)value;
+    }
+    cv::Mat table(1, 256, CV_8UC1, Scalar(0));
+    transform(values).copyTo(table.colRange(low, high + 1));
+
+    cv::Mat plateMat;
+    cv::LUT(originalMat, table, plateMat);
+    return plateMat;
+}
+
+bool CanUseLookupTable(const cv::Mat &originalMat) {
+    return !originalMat.empty() && originalMat.depth() == CV_8U &&
+           (originalMat.channels() == 1 || originalMat.channels() == 3);
+}
+} // namespace
+
 cv::Mat Utilities::IndexTransform(cv::Mat &originalMat) {
+    if (!CanUseLookupTable(originalMat))
+        return IndexTransformByFloat(originalMat);
+    return TransformByLookupTable(originalMat, [](cv::Mat &values) {
+        return IndexTransformByFloat(values);
+    });
+}
+
+cv::Mat Utilities::LogTransform(cv::Mat &originalMat) {
+    if (!CanUseLookupTable(originalMat))
+        return LogTransformByFloat(originalMat);
+    return TransformByLookupTable(originalMat, [](cv::Mat &values) {
+        return LogTransformByFloat(values);
+    });
+}
+
+cv::Mat Utilities::GammaTransform(cv::Mat &originalMat, float gammaFactor) {
+    if (!CanUseLookupTable(originalMat))
+        return GammaTransformByFloat(originalMat, gammaFactor);
+    return TransformByLookupTable(originalMat, [gammaFactor](cv::Mat &values) {
+        return GammaTransformByFloat(values, gammaFactor);
+    });
+}
+
+cv::Mat Utilities::IndexTransformByFloat(cv::Mat &originalMat) {
     cv::Mat plateMat = originalMat.clone();
     if (plateMat.channels() == 1) {
         cv::Mat midMat = originalMat.clone();
@@ -28,7 +80,7 @@ cv::Mat Utilities::IndexTransform(cv::Mat &originalMat) {
     return plateMat;
 }
 
-cv::Mat Utilities::LogTransform(cv::Mat &originalMat) {
+cv::Mat Utilities::LogTransformByFloat(cv::Mat &originalMat) {
     cv::Mat plateMat = originalMat.clone();
     if (plateMat.channels() == 1) {
         plateMat.convertTo(plateMat, CV_32FC1);
@@ -59,7 +111,8 @@ cv::Mat Utilities::LogTransform(cv::Mat &originalMat) {
     return plateMat;
 }
 
-cv::Mat Utilities::GammaTransform(cv::Mat &originalMat, float gammaFactor) {
+cv::Mat Utilities::GammaTransformByFloat(cv::Mat &originalMat,
+                                         float gammaFactor) {
     cv::Mat plateMat = originalMat.clone();
 
     if (plateMat.channels() == 1) {
@@ -21,12 +21,22 @@ namespace PlateRecogn {
 
 class Utilities {
   public:
+    // 8 位图像先求最小、最大值，再对 [min, max] 中的每个值算一次变换，
+    // 用 cv::LUT 查表，结果与下面逐像素的浮点实现相差不超过 1
     static cv::Mat IndexTransform(cv::Mat &originalMat);
 
     static cv::Mat LogTransform(cv::Mat &originalMat);
 
     static cv::Mat GammaTransform(cv::Mat &originalMat, float gammaFactor);
 
+    // 逐像素的浮点实现，非 8 位图像和生成查找表时使用
+    static cv::Mat IndexTransformByFloat(cv::Mat &originalMat);
+
+    static cv::Mat LogTransformByFloat(cv::Mat &originalMat);
+
+    static cv::Mat GammaTransformByFloat(cv::Mat &originalMat,
+                                         float gammaFactor);
+
     static cv::Mat LaplaceTransform(cv::Mat &originalMat);
 
     static Rect GetSafeRect(const Rect &rect, const Mat &mat);
@@ -0,0 +1,86 @@
+#include "PlateCategory_SVM.h"
+#include "PlateChar_SVM.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+using namespace Doit::CV::PlateRecogn;
+
+// 把 YAML 模型转换成 SaveBinary 的二进制文件，并比较两种文件的加载耗时。
+// 用法: convert_SVM_model char|category in.yaml out.bin [nystromLandmarkCount]
+//       [float|int8|fp16]
+// 后两个参数只对字符模型有效：把 Nyström 近似后的权重、量化后的支持向量
+// 存进文件，nystromLandmarkCount 为 0 时不做近似
+template <typename Classifier, typename LoadYaml>
+int Convert(const string &inFile, const string &outFile, LoadYaml loadYaml) {
+    Classifier yamlModel;
+    auto start = steady_clock::now();
+    loadYaml(yamlModel);
+    auto middle = steady_clock::now();
+    yamlModel.SaveBinary(outFile);
+
+    Classifier binaryModel;
+    auto binaryStart = steady_clock::now();
+    binaryModel.Load(outFile);
+    auto stop = steady_clock::now();
+
+    cout << inFile << " -> " << outFile << endl
+         << "yaml load us: "
+         << duration_cast<microseconds>(middle - start).count()
+         << ", binary load us: "
+         << duration_cast<microseconds>(stop - binaryStart).count() << endl;
+    return 0;
+}
+
+int main(int argc, char const *argv[]) {
+    if (argc < 4) {
+        cerr << "usage: " << argv[0]
+             << " char|category in.yaml out.bin [nystromLandmarkCount]"
+                " [float|int8|fp16]"
+             << endl;
+        return 1;
+    }
+    string kind = argv[1];
+    string inFile = argv[2];
+    string outFile = argv[3];
+    int landmarkCount = argc > 4 ? std::atoi(argv[4]) : 0;
+    string storageName = argc > 5 ? argv[5] : "float";
+    SVMPredictor::VectorStorage storage = SVMPredictor::VectorStorage::Float32;
+    if (storageName == "int8") {
+        storage = SVMPredictor::VectorStorage::Int8;
+    } else if (storageName == "fp16") {
+        storage = SVMPredictor::VectorStorage::Float16;
+    } else if (storageName != "float") {
+        cerr << "unknown vector storage: " << storageName << endl;
+        return 1;
+    }
+
+    try {
+        if (kind == "char") {
+            return Convert<PlateChar_SVM>(
+                inFile, outFile, [&](PlateChar_SVM &classifier) {
+                    classifier.Load(inFile, landmarkCount);
+                    if (!classifier.Quantize(storage))
+                        cerr << "vector storage " << storageName
+                             << " is not applicable, saved as float" << endl;
+                });
+        }
+        if (kind == "category") {
+            return Convert<PlateCategory_SVM>(
+                inFile, outFile,
+                [&](PlateCategory_SVM &classifier) { classifier.Load(inFile); });
+        }
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    cerr << "unknown model kind: " << kind << endl;
+    return 1;
+}
@@ -5,6 +5,11 @@ using cv::Mat;
 using cv::Point2i;
 using cv::Rect;
 
+#include <cassert>
+#include <chrono>
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
 #include <iostream>
 using std::cout;
 using std::endl;
@@ -22,13 +27,18 @@ using std::get;
 #include "PlateCategory_SVM.h"
 #include "PlateChar_SVM.h"
 
+#include "PlateLocator_V3.h"
+#include "PlateRecognition_V3.h"
+#include "Utilities.h"
+
 using namespace Doit::CV::PlateRecogn;
 
 #include "debug.h"
+static PlateRecognition_V3 recognizer;
+
 void InitSvm() {
     try {
-        PlateCategory_SVM::Load("CategorySVM.yaml");
-        PlateChar_SVM::Load("CharSVM.yaml");
+        recognizer.Load("CategorySVM.yaml", "CharSVM.yaml");
     } catch (exception &e) {
         cerr << e.what() << endl;
         exit(0);
@@ -103,7 +113,8 @@ void test_SplitePlateForAutoSample() {
     image = image(rectRoi);
     //DebugVisualizeNotWait("Origin", image);
 
-    auto ret = CharSegment_V3::SplitePlateForAutoSample(image);
+    auto ret =
+        CharSegment_V3::SplitePlateForAutoSample(recognizer.CharSVM, image);
     auto CharInfos = get<0>(ret[0]);
     auto Binimage = get<1>(ret[0]);
     auto Rectimage = get<2>(ret[0]);
@@ -126,8 +137,6 @@ void test_SplitePlateForAutoSample() {
 }
 
 
-#include "PlateLocator_V3.h"
-#include "PlateRecognition_V3.h"
 void test_GetPlateInfo() {
     auto data = get_test_data(7);
     Mat image = get<0>(data);
@@ -146,7 +155,7 @@ void test_GetPlateInfo() {
                            image,
                            {},
                            PlateLocateMethod_t::Color};
-    PlateInfo recognizedPlateInfo = PlateRecognition_V3::GetPlateInfo(
+    PlateInfo recognizedPlateInfo = recognizer.GetPlateInfo(
         plateInfo, color, CharSplitMethod_t::Origin);
 
     auto recognizedCharInfos = recognizedPlateInfo.CharInfos;
@@ -164,10 +173,181 @@ void test_GetPlateInfo() {
     cout << "Real license " << license << endl;
 }
 
+// ClearBorderAndMaoding 必须和 ClearMaoding(ClearBorder()) 逐像素相同，
+// 在 plates 下所有车牌样本的二值图上比较两者的耗时
+void benchmark_ClearBorderAndMaoding(
+    const string &platesPath = "../../bin/platecharsamples/plates") {
+    vector<Mat> thresholds;
+    for (auto &category : Directory::GetFiles(platesPath)) {
+        for (auto &file : Directory::GetFiles(category)) {
+            Mat plate = imread(file);
+            if (plate.empty())
+                continue;
+            Mat gray, threshold;
+            cv::cvtColor(plate, gray, cv::COLOR_BGR2GRAY);
+            cv::threshold(gray, threshold, 1, 255,
+                          cv::THRESH_OTSU | cv::THRESH_BINARY);
+            thresholds.push_back(threshold);
+        }
+    }
+
+    size_t mismatchCount = 0;
+    steady_clock::duration separateTime{0}, fusedTime{0};
+    for (auto &threshold : thresholds) {
+        auto start = steady_clock::now();
+        Mat border = CharSegment_V3::ClearBorder(threshold);
+        Mat expected = CharSegment_V3::ClearMaoding(border);
+        auto middle = steady_clock::now();
+        Mat fused = threshold.clone();
+        CharSegment_V3::ClearBorderAndMaoding(fused);
+        auto end = steady_clock::now();
+        separateTime += middle - start;
+        fusedTime += end - middle;
+        if (cv::countNonZero(expected != fused) > 0)
+            ++mismatchCount;
+    }
+    cout << "clear border and maoding: " << thresholds.size()
+         << " plates, mismatch: " << mismatchCount << ", separate us: "
+         << duration_cast<microseconds>(separateTime).count()
+         << ", fused us (including clone): "
+         << duration_cast<microseconds>(fusedTime).count() << endl;
+    assert(mismatchCount == 0);
+}
+
+// FindCharCandidates 的外接矩形必须和 findContours 的相同，切分结果也相同
+void benchmark_FindCharCandidates(
+    const string &platesPath = "../../bin/platecharsamples/plates") {
+    auto rectLess = [](const Rect &x, const Rect &y) {
+        return std::make_tuple(x.x, x.y, x.width, x.height) <
+               std::make_tuple(y.x, y.y, y.width, y.height);
+    };
+    size_t plateCount = 0, rectMismatchCount = 0, splitMismatchCount = 0;
+    steady_clock::duration contoursTime{0}, componentsTime{0};
+    for (auto &category : Directory::GetFiles(platesPath)) {
+        for (auto &file : Directory::GetFiles(category)) {
+            Mat plate = imread(file);
+            if (plate.empty())
+                continue;
+            ++plateCount;
+            Mat gray, binary;
+            cv::cvtColor(plate, gray, cv::COLOR_BGR2GRAY);
+            PlateColor_t color = PlateColor_t::BluePlate;
+            binary = CharSegment_V3::ClearMaodingAndBorder(gray, color);
+
+            auto start = steady_clock::now();
+            std::vector<std::vector<cv::Point>> contours;
+            cv::findContours(binary, contours, cv::RETR_EXTERNAL,
+                             cv::CHAIN_APPROX_NONE);
+            vector<Rect> expected;
+            for (auto &contour : contours) {
+                expected.push_back(cv::boundingRect(contour));
+            }
+            auto middle = steady_clock::now();
+            vector<Rect> actual;
+            for (auto &candidate : CharSegment_V3::FindCharCandidates(binary)) {
+                actual.push_back(candidate.BoundingRect);
+            }
+            auto end = steady_clock::now();
+            contoursTime += middle - start;
+            componentsTime += end - middle;
+            std::sort(expected.begin(), expected.end(), rectLess);
+            std::sort(actual.begin(), actual.end(), rectLess);
+            if (expected != actual)
+                ++rectMismatchCount;
+
+            SplitTransformCache transforms(plate);
+            vector<CharCandidate> candidates;
+            auto byContours = CharSegment_V3::SplitePlate(
+                contours, transforms, color, CharSplitMethod_t::Origin);
+            auto byComponents = CharSegment_V3::SplitePlate(
+                candidates, transforms, color, CharSplitMethod_t::Origin);
+            bool same = byContours.size() == byComponents.size();
+            for (size_t i = 0; same && i < byContours.size(); ++i) {
+                same = byContours[i].OriginalRect ==
+                       byComponents[i].OriginalRect;
+            }
+            if (!same)
+                ++splitMismatchCount;
+        }
+    }
+    cout << "find char candidates: " << plateCount
+         << " plates, rect mismatch: " << rectMismatchCount
+         << ", split mismatch: " << splitMismatchCount << ", contours us: "
+         << duration_cast<microseconds>(contoursTime).count()
+         << ", components us: "
+         << duration_cast<microseconds>(componentsTime).count() << endl;
+    assert(rectMismatchCount == 0);
+    assert(splitMismatchCount == 0);
+}
+
+Mat ApplyTransform(int transform, Mat &image, bool byFloat) {
+    switch (transform) {
+    case 0:
+        return byFloat ? Utilities::IndexTransformByFloat(image)
+                       : Utilities::IndexTransform(image);
+    case 1:
+        return byFloat ? Utilities::LogTransformByFloat(image)
+                       : Utilities::LogTransform(image);
+    default:
+        return byFloat ? Utilities::GammaTransformByFloat(image, 0.40f)
+                       : Utilities::GammaTransform(image, 0.40f);
+    }
+}
+
+// 查表和浮点两种实现的耗时与最大差值，images 是车牌或整帧图像
+void benchmark_Transforms(const string &name, vector<Mat> &images) {
+    const char *transformNames[] = {"index", "log", "gamma"};
+    for (int transform = 0; transform < 3; transform++) {
+        double maxDifference = 0;
+        steady_clock::duration floatTime{0}, tableTime{0};
+        for (auto &image : images) {
+            auto start = steady_clock::now();
+            Mat expected = ApplyTransform(transform, image, true);
+            auto middle = steady_clock::now();
+            Mat actual = ApplyTransform(transform, image, false);
+            auto end = steady_clock::now();
+            floatTime += middle - start;
+            tableTime += end - middle;
+            maxDifference = std::max(
+                maxDifference, cv::norm(expected, actual, cv::NORM_INF));
+        }
+        cout << name << " " << transformNames[transform] << ": "
+             << images.size() << " images, max difference: " << maxDifference
+             << ", float us: " << duration_cast<microseconds>(floatTime).count()
+             << ", table us: " << duration_cast<microseconds>(tableTime).count()
+             << endl;
+    }
+}
+
+void benchmark_Transforms(
+    const string &platesPath = "../../bin/platecharsamples/plates",
+    const string &framesPath = "../../bin/licenses") {
+    vector<Mat> plates, frames;
+    for (auto &category : Directory::GetFiles(platesPath)) {
+        for (auto &file : Directory::GetFiles(category)) {
+            Mat plate = imread(file);
+            if (!plate.empty())
+                plates.push_back(plate);
+        }
+    }
+    for (auto &file : Directory::GetFiles(framesPath)) {
+        Mat frame = imread(file);
+        if (!frame.empty())
+            frames.push_back(frame);
+        if (frames.size() >= 50)
+            break;
+    }
+    benchmark_Transforms("plates", plates);
+    benchmark_Transforms("frames", frames);
+}
+
 int main(int argc, char const *argv[]) {
     InitSvm();
     // test_SplitePlateByGammaTransform();
     // test_GetPlateInfo();
+    // benchmark_ClearBorderAndMaoding();
+    // benchmark_Transforms();
+    // benchmark_FindCharCandidates();
     test_SplitePlateForAutoSample();
     return 0;
 }
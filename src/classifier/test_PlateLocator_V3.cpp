@@ -0,0 +1,301 @@
+#include "CharInfo.h"
+#include "PlateCategory_SVM.h"
+#include "PlateColorMask.h"
+#include "PlateLocator_V3.h"
+#include "ThreadPool.h"
+using namespace Doit::CV::PlateRecogn;
+
+#include "debug.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+using cv::imread;
+using cv::Mat;
+using cv::Rect;
+
+#include <cassert>
+#include <chrono>
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+#include <iostream>
+using std::cerr;
+using std::cout;
+using std::endl;
+#include <string>
+using std::string;
+#include <algorithm>
+using std::max;
+#include <vector>
+using std::vector;
+
+static PlateCategory_SVM plateCategorySVM;
+
+void InitSvm() {
+    try {
+        plateCategorySVM.Load("CategorySVM.yaml");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        exit(0);
+    }
+}
+
+// 加载整帧图片，count=-1 代表全部
+vector<Mat> load_frames_from_directory(const string &name, int count = -1) {
+    auto allFiles = Directory::GetFiles(name);
+    vector<Mat> ret = {};
+    if (count == -1 || count > (int)allFiles.size())
+        count = allFiles.size();
+    for (int i = 0; i < count; ++i) {
+        Mat frame = imread(allFiles[i]);
+        if (!frame.empty())
+            ret.push_back(frame);
+    }
+    return ret;
+}
+
+static auto frames = load_frames_from_directory("../../bin/licenses", 200);
+
+// 原来 LocatePlatesByColor 中的颜色掩码计算
+void reference_ColorMask(const Mat &matSource, Mat &threshold) {
+    Mat hsv;
+    cv::cvtColor(matSource, hsv, cv::COLOR_BGR2HSV);
+    vector<Mat> hsvSplits;
+    cv::split(hsv, hsvSplits);
+    cv::equalizeHist(hsvSplits[2], hsvSplits[2]);
+    Mat hsvEqualizeHist;
+    cv::merge(hsvSplits, hsvEqualizeHist);
+    Mat blue;
+    cv::inRange(hsvEqualizeHist, cv::Scalar(100, 70, 70),
+                cv::Scalar(140, 255, 255), blue);
+    Mat yellow;
+    cv::inRange(hsvEqualizeHist, cv::Scalar(15, 70, 70),
+                cv::Scalar(40, 255, 255), yellow);
+    Mat add = blue + yellow;
+    cv::threshold(add, threshold, 0, 255,
+                  cv::ThresholdTypes::THRESH_OTSU |
+                      cv::ThresholdTypes::THRESH_BINARY);
+}
+
+// 融合后的颜色掩码必须和原来的完全一致，并比较两者的耗时
+void benchmark_ColorMask(int repeat = 10) {
+    size_t mismatchCount = 0;
+    steady_clock::duration referenceTime{0}, fusedTime{0};
+    Mat expected, mask;
+    for (auto &frame : frames) {
+        for (int n = 0; n < repeat; ++n) {
+            auto start = steady_clock::now();
+            reference_ColorMask(frame, expected);
+            auto middle = steady_clock::now();
+            PlateColorMask::Compute(frame, mask);
+            auto end = steady_clock::now();
+            referenceTime += middle - start;
+            fusedTime += end - middle;
+        }
+        if (cv::countNonZero(expected != mask) != 0)
+            ++mismatchCount;
+    }
+    cout << "color mask: " << frames.size() << " frames x " << repeat
+         << ", mismatch: " << mismatchCount << ", reference us: "
+         << duration_cast<microseconds>(referenceTime).count()
+         << ", fused us: " << duration_cast<microseconds>(fusedTime).count()
+         << endl;
+    assert(mismatchCount == 0);
+}
+
+bool same_plates(const vector<PlateInfo> &x, const vector<PlateInfo> &y) {
+    if (x.size() != y.size())
+        return false;
+    for (size_t i = 0; i < x.size(); ++i) {
+        if (x[i].OriginalRect != y[i].OriginalRect ||
+            x[i].PlateCategory != y[i].PlateCategory ||
+            x[i].PlateLocateMethod != y[i].PlateLocateMethod)
+            return false;
+    }
+    return true;
+}
+
+// 推测执行 Sobel 法的结果必须和串行一致，比较平均和最长的单帧耗时
+void benchmark_SpeculativeSobel() {
+    ThreadPool taskPool(1);
+    PlateLocatorConfig config;
+    PlateLocatorConfig speculativeConfig;
+    speculativeConfig.SpeculativeSobel = true;
+    PlateLocatorScratch scratch;
+
+    size_t mismatchCount = 0;
+    steady_clock::duration serialTime{0}, speculativeTime{0};
+    steady_clock::duration serialMax{0}, speculativeMax{0};
+    for (auto &frame : frames) {
+        auto start = steady_clock::now();
+        auto serial =
+            PlateLocator_V3::LocatePlates(plateCategorySVM, frame, config);
+        auto middle = steady_clock::now();
+        auto speculative = PlateLocator_V3::LocatePlates(
+            plateCategorySVM, frame, speculativeConfig, scratch, &taskPool);
+        auto end = steady_clock::now();
+        serialTime += middle - start;
+        speculativeTime += end - middle;
+        serialMax = max(serialMax, middle - start);
+        speculativeMax = max(speculativeMax, end - middle);
+        if (!same_plates(serial, speculative))
+            ++mismatchCount;
+    }
+    cout << "speculative sobel: " << frames.size()
+         << " frames, mismatch: " << mismatchCount << ", serial us: "
+         << duration_cast<microseconds>(serialTime).count() << " (max "
+         << duration_cast<microseconds>(serialMax).count()
+         << "), speculative us: "
+         << duration_cast<microseconds>(speculativeTime).count() << " (max "
+         << duration_cast<microseconds>(speculativeMax).count() << ")"
+         << endl;
+    assert(mismatchCount == 0);
+}
+
+// 缩小 scale 倍粗定位再在原图上细定位，与全图定位比较耗时和找到的车牌
+void benchmark_PyramidLocate(int scale = 2) {
+    PlateLocatorConfig config;
+    PlateLocatorConfig pyramidConfig;
+    pyramidConfig.PyramidScale = scale;
+    PlateLocatorScratch scratch, pyramidScratch;
+
+    size_t fullCount = 0, pyramidCount = 0, matchedCount = 0;
+    steady_clock::duration fullTime{0}, pyramidTime{0};
+    for (auto &frame : frames) {
+        auto start = steady_clock::now();
+        auto full = PlateLocator_V3::LocatePlates(plateCategorySVM, frame,
+                                                  config, scratch);
+        auto middle = steady_clock::now();
+        auto pyramid = PlateLocator_V3::LocatePlates(
+            plateCategorySVM, frame, pyramidConfig, pyramidScratch);
+        auto end = steady_clock::now();
+        fullTime += middle - start;
+        pyramidTime += end - middle;
+
+        fullCount += full.size();
+        pyramidCount += pyramid.size();
+        // 重叠超过一半就认为是同一块车牌
+        for (auto &x : full) {
+            for (auto &y : pyramid) {
+                if ((x.OriginalRect & y.OriginalRect).area() * 2 >
+                    x.OriginalRect.area()) {
+                    ++matchedCount;
+                    break;
+                }
+            }
+        }
+    }
+    cout << "pyramid locate x" << scale << ": " << frames.size()
+         << " frames, full plates: " << fullCount
+         << ", pyramid plates: " << pyramidCount
+         << ", matched: " << matchedCount << ", full us: "
+         << duration_cast<microseconds>(fullTime).count() << ", pyramid us: "
+         << duration_cast<microseconds>(pyramidTime).count() << endl;
+}
+
+bool same_mat(const Mat &x, const Mat &y) {
+    return x.size() == y.size() && x.type() == y.type() &&
+           cv::countNonZero(x != y) == 0;
+}
+
+// 分块并行的中间结果和车牌必须和不分块完全一样，比较两者的耗时
+void benchmark_TiledLocate(int bandCount = 8) {
+    ThreadPool taskPool;
+    PlateLocatorConfig config;
+    PlateLocatorConfig tiledConfig;
+    tiledConfig.BandCount = bandCount;
+    PlateLocatorPipeline pipeline(plateCategorySVM, config);
+    PlateLocatorPipeline tiledPipeline(plateCategorySVM, tiledConfig);
+    tiledPipeline.SetTaskPool(&taskPool);
+
+    size_t mismatchCount = 0;
+    steady_clock::duration untiledTime{0}, tiledTime{0};
+    for (auto &frame : frames) {
+        auto start = steady_clock::now();
+        pipeline.SetSource(frame);
+        pipeline.GetColorContours();
+        pipeline.GetSobelContours();
+        auto middle = steady_clock::now();
+        tiledPipeline.SetSource(frame);
+        tiledPipeline.GetColorContours();
+        tiledPipeline.GetSobelContours();
+        auto end = steady_clock::now();
+        untiledTime += middle - start;
+        tiledTime += end - middle;
+
+        bool same =
+            same_mat(pipeline.GetColorThreshold(),
+                     tiledPipeline.GetColorThreshold()) &&
+            same_mat(pipeline.GetColorErode(), tiledPipeline.GetColorErode()) &&
+            same_mat(pipeline.GetSobelThreshold(),
+                     tiledPipeline.GetSobelThreshold()) &&
+            same_mat(pipeline.GetSobelErode(), tiledPipeline.GetSobelErode()) &&
+            same_plates(pipeline.LocatePlates(), tiledPipeline.LocatePlates());
+        if (!same)
+            ++mismatchCount;
+    }
+    cout << "tiled locate: " << frames.size() << " frames, " << bandCount
+         << " bands, " << taskPool.Size() + 1
+         << " threads, mismatch: " << mismatchCount << ", untiled us: "
+         << duration_cast<microseconds>(untiledTime).count() << ", tiled us: "
+         << duration_cast<microseconds>(tiledTime).count() << endl;
+    assert(mismatchCount == 0);
+}
+
+// 区域覆盖整幅图时结果不变；只看下半幅时车牌都在区域内，坐标仍是整幅图的
+void test_RegionOfInterest() {
+    PlateLocatorConfig config;
+    PlateLocatorScratch scratch;
+    size_t mismatchCount = 0, outsideCount = 0;
+    steady_clock::duration fullTime{0}, regionTime{0};
+    for (auto &frame : frames) {
+        PlateLocatorConfig wholeConfig;
+        wholeConfig.RegionPolygon = {{0, 0},
+                                     {frame.cols - 1, 0},
+                                     {frame.cols - 1, frame.rows - 1},
+                                     {0, frame.rows - 1}};
+        PlateLocatorConfig halfConfig;
+        halfConfig.RegionOfInterest =
+            Rect(0, frame.rows / 2, frame.cols, frame.rows - frame.rows / 2);
+
+        auto start = steady_clock::now();
+        auto full = PlateLocator_V3::LocatePlates(plateCategorySVM, frame,
+                                                  config, scratch);
+        auto middle = steady_clock::now();
+        auto half = PlateLocator_V3::LocatePlates(plateCategorySVM, frame,
+                                                  halfConfig, scratch);
+        auto end = steady_clock::now();
+        fullTime += middle - start;
+        regionTime += end - middle;
+
+        auto whole = PlateLocator_V3::LocatePlates(plateCategorySVM, frame,
+                                                   wholeConfig, scratch);
+        if (!same_plates(full, whole))
+            ++mismatchCount;
+        for (auto &plateInfo : half) {
+            if ((plateInfo.OriginalRect & halfConfig.RegionOfInterest) !=
+                plateInfo.OriginalRect)
+                ++outsideCount;
+        }
+    }
+    cout << "region of interest: " << frames.size()
+         << " frames, mismatch: " << mismatchCount
+         << ", outside: " << outsideCount << ", full us: "
+         << duration_cast<microseconds>(fullTime).count()
+         << ", lower half us: "
+         << duration_cast<microseconds>(regionTime).count() << endl;
+    assert(mismatchCount == 0 && outsideCount == 0);
+}
+
+int main(int argc, char const *argv[]) {
+    InitSvm();
+    benchmark_ColorMask();
+    // benchmark_SpeculativeSobel();
+    // benchmark_PyramidLocate();
+    // benchmark_TiledLocate();
+    // test_RegionOfInterest();
+    std::cin.get();
+
+    return 0;
+}
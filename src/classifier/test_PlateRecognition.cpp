@@ -17,6 +17,11 @@ using cv::Point2i;
 using cv::resize;
 using cv::Size;
 
+#include <cassert>
+#include <chrono>
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
 #include <iostream>
 using std::cerr;
 using std::cout;
@@ -27,17 +32,29 @@ using std::pair;
 using std::tuple;
 #include <vector>
 using std::vector;
+#include <atomic>
+using std::atomic;
+#include <thread>
+using std::thread;
+
+static PlateRecognition_V3 recognizer;
 
 void InitSvm() {
     try {
-        PlateCategory_SVM::Load("CategorySVM.yaml");
-        PlateChar_SVM::Load("CharSVM.yaml");
+        recognizer.Load("CategorySVM.yaml", "CharSVM.yaml");
     } catch (exception &e) {
         cerr << e.what() << endl;
         exit(0);
     }
 }
 
+// 比较配置时另建的引擎使用与 recognizer 相同的全部模型
+void CopyModels(PlateRecognition_V3 &target) {
+    target.CategorySVM = recognizer.CategorySVM;
+    target.CharSVM = recognizer.CharSVM;
+    target.CharCascade = recognizer.CharCascade;
+}
+
 // 加载数据，count=-1 代表全部
 // @return: image, label, path
 vector<tuple<Mat, string, string>>
@@ -104,7 +121,7 @@ void test_Recoginition() {
         string filePath = get<2>(sample);
         string fileName = filePath.substr(filePath.find_last_of(DIRECTORY_DELIMITER) + 1);
 
-        auto plateInfos = PlateRecognition_V3::Recognite(image);
+        auto plateInfos = recognizer.Recognite(image);
         for (auto &plateInfo : plateInfos) {
             cout << "recog: " << plateInfo.ToString() << " | real: " << license << endl;
             if (license == plateInfo.ToString()) {
@@ -153,7 +170,7 @@ void singleImage_getPlateInfo() {
     string filePath = get<2>(sample);
     string fileName = filePath.substr(filePath.find_last_of("/") + 1);
 
-    auto plateInfos = PlateRecognition_V3::Recognite(image);
+    auto plateInfos = recognizer.Recognite(image);
     // auto plateInfos = PlateRecognition_V3::GetPlateInfo()
     for (auto &plateInfo : plateInfos) {
         cout << "Real: " << license << endl;
@@ -184,7 +201,7 @@ void view_Image(int index) {
     string license = get<1>(sample);
     string filePath = get<2>(sample);
     DebugVisualize("origin", image);
-    auto plateInfos = PlateRecognition_V3::Recognite(image);
+    auto plateInfos = recognizer.Recognite(image);
     for (auto &plateInfo : plateInfos) {
         cout << plateInfo.Info() << endl;
     }
@@ -197,9 +214,254 @@ void view_Image(int index) {
 
 void test_CharSplit() {}
 
+// 同一个 recognizer 被多个线程同时调用，结果必须和单线程一致
+void test_ConcurrentRecognition(size_t threadCount = 8,
+                                size_t sampleCount = 200) {
+    sampleCount = std::min(sampleCount, test_set.size());
+    auto recogniteToString = [](const Mat &image) {
+        string ret;
+        for (auto &plateInfo : recognizer.Recognite(image)) {
+            ret += plateInfo.ToString() + "|";
+        }
+        return ret;
+    };
+
+    vector<string> expected(sampleCount);
+    for (size_t i = 0; i < sampleCount; ++i) {
+        expected[i] = recogniteToString(get<0>(get_test_data(i)));
+    }
+
+    atomic<size_t> mismatchCount(0);
+    vector<thread> workers;
+    for (size_t t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&, t]() {
+            // 每个线程从不同的位置开始，让不同的图片同时被识别
+            for (size_t n = 0; n < sampleCount; ++n) {
+                size_t i = (n + t * sampleCount / threadCount) % sampleCount;
+                if (recogniteToString(get<0>(get_test_data(i))) !=
+                    expected[i]) {
+                    ++mismatchCount;
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    cout << "concurrent recognition: " << threadCount << " threads x "
+         << sampleCount << " images, mismatch: " << mismatchCount << endl;
+    assert(mismatchCount == 0);
+}
+
+// 8 个候选并行计算，选出的结果必须和串行一致
+void test_ParallelCandidates(size_t sampleCount = 200) {
+    sampleCount = std::min(sampleCount, test_set.size());
+    PlateRecognition_V3 parallelRecognizer;
+    CopyModels(parallelRecognizer);
+    parallelRecognizer.TaskPool = std::make_shared<ThreadPool>();
+
+    size_t mismatchCount = 0;
+    steady_clock::duration serialTime{0}, parallelTime{0};
+    for (size_t i = 0; i < sampleCount; ++i) {
+        Mat image = get<0>(get_test_data(i));
+        auto start = steady_clock::now();
+        auto serial = recognizer.Recognite(image);
+        auto middle = steady_clock::now();
+        auto parallel = parallelRecognizer.Recognite(image);
+        auto end = steady_clock::now();
+        serialTime += middle - start;
+        parallelTime += end - middle;
+
+        bool same = serial.size() == parallel.size();
+        for (size_t p = 0; same && p < serial.size(); ++p) {
+            same = serial[p].ToString() == parallel[p].ToString() &&
+                   serial[p].PlateColor == parallel[p].PlateColor;
+        }
+        if (!same)
+            ++mismatchCount;
+    }
+    cout << "parallel candidates: " << sampleCount
+         << " images, mismatch: " << mismatchCount
+         << ", serial ms: "
+         << duration_cast<milliseconds>(serialTime).count()
+         << ", parallel ms: "
+         << duration_cast<milliseconds>(parallelTime).count() << endl;
+    assert(mismatchCount == 0);
+}
+
+// Exhaustive 和 FirstGoodEnough 在 cleanPlateSamples 上的准确率、耗时和
+// 每张车牌实际计算的候选数
+void benchmark_CandidatePolicy(size_t sampleCount = 1000) {
+    sampleCount = std::min(sampleCount, test_set.size());
+    const CandidatePolicy_t policies[] = {CandidatePolicy_t::Exhaustive,
+                                          CandidatePolicy_t::FirstGoodEnough};
+    for (auto policy : policies) {
+        PlateRecognition_V3 policyRecognizer;
+        CopyModels(policyRecognizer);
+        policyRecognizer.Config.CandidatePolicy = policy;
+        policyRecognizer.Config.ParallelCandidates = false;
+
+        size_t correctCount = 0;
+        steady_clock::duration elapsed{0};
+        for (size_t i = 0; i < sampleCount; ++i) {
+            auto sample = get_test_data(i);
+            auto start = steady_clock::now();
+            auto plateInfos = policyRecognizer.Recognite(get<0>(sample));
+            elapsed += steady_clock::now() - start;
+            for (auto &plateInfo : plateInfos) {
+                if (plateInfo.ToString() == get<1>(sample)) {
+                    ++correctCount;
+                    break;
+                }
+            }
+        }
+
+        auto statistics = policyRecognizer.GetCandidateStatistics();
+        size_t plateCount = std::max<size_t>(statistics.PlateCount, 1);
+        cout << (policy == CandidatePolicy_t::Exhaustive ? "Exhaustive"
+                                                         : "FirstGoodEnough")
+             << ": accuracy " << correctCount << " / " << sampleCount
+             << ", ms: " << duration_cast<milliseconds>(elapsed).count()
+             << ", plates: " << statistics.PlateCount
+             << ", candidates per plate: "
+             << float(statistics.EvaluatedCount) / plateCount
+             << ", skipped per plate: "
+             << float(statistics.SkippedCount) / plateCount << endl;
+    }
+}
+
+// 按版式限制字符类别前后在 cleanPlateSamples 上的准确率
+void benchmark_PlateLayout(size_t sampleCount = 1000) {
+    sampleCount = std::min(sampleCount, test_set.size());
+    for (bool constrain : {false, true}) {
+        PlateRecognition_V3 layoutRecognizer;
+        CopyModels(layoutRecognizer);
+        layoutRecognizer.Config.ConstrainCharsByLayout = constrain;
+
+        size_t correctCount = 0;
+        for (size_t i = 0; i < sampleCount; ++i) {
+            auto sample = get_test_data(i);
+            for (auto &plateInfo : layoutRecognizer.Recognite(get<0>(sample))) {
+                if (plateInfo.ToString() == get<1>(sample)) {
+                    ++correctCount;
+                    break;
+                }
+            }
+        }
+        cout << (constrain ? "layout constrained" : "unconstrained")
+             << ": accuracy " << correctCount << " / " << sampleCount << endl;
+    }
+}
+
+// 先变换 BGR 再转灰度和先转灰度再变换两种切分输入在 cleanPlateSamples 上的
+// 准确率和耗时，以及识别结果不同的样本数
+void benchmark_SplitTransformInput(size_t sampleCount = 1000) {
+    sampleCount = std::min(sampleCount, test_set.size());
+    const SplitTransformInput_t inputs[] = {SplitTransformInput_t::Bgr,
+                                            SplitTransformInput_t::Gray};
+    vector<string> firstResults(sampleCount);
+    for (auto input : inputs) {
+        PlateRecognition_V3 inputRecognizer;
+        CopyModels(inputRecognizer);
+        inputRecognizer.Config.SplitTransformInput = input;
+        inputRecognizer.Config.ParallelCandidates = false;
+
+        size_t correctCount = 0, differentCount = 0;
+        steady_clock::duration elapsed{0};
+        for (size_t i = 0; i < sampleCount; ++i) {
+            auto sample = get_test_data(i);
+            auto start = steady_clock::now();
+            auto plateInfos = inputRecognizer.Recognite(get<0>(sample));
+            elapsed += steady_clock::now() - start;
+            string results;
+            bool correct = false;
+            for (auto &plateInfo : plateInfos) {
+                results += plateInfo.ToString() + ";";
+                correct = correct || plateInfo.ToString() == get<1>(sample);
+            }
+            if (correct)
+                ++correctCount;
+            if (input == SplitTransformInput_t::Bgr)
+                firstResults[i] = results;
+            else if (firstResults[i] != results)
+                ++differentCount;
+        }
+
+        cout << (input == SplitTransformInput_t::Bgr ? "Bgr" : "Gray")
+             << ": accuracy " << correctCount << " / " << sampleCount
+             << ", ms: " << duration_cast<milliseconds>(elapsed).count();
+        if (input != SplitTransformInput_t::Bgr)
+            cout << ", different from Bgr: " << differentCount;
+        cout << endl;
+    }
+}
+
+// RecogniteBatch 的结果必须和逐帧 Recognite 一致
+void test_RecogniteBatch(size_t sampleCount = 1000) {
+    sampleCount = std::min(sampleCount, test_set.size());
+    vector<Mat> frames;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        frames.push_back(get<0>(get_test_data(i)));
+    }
+
+    PlateRecognition_V3 batchRecognizer;
+    CopyModels(batchRecognizer);
+    batchRecognizer.TaskPool = std::make_shared<ThreadPool>();
+
+    auto start = steady_clock::now();
+    vector<vector<PlateInfo>> expected;
+    for (auto &frame : frames) {
+        expected.push_back(recognizer.Recognite(frame));
+    }
+    auto middle = steady_clock::now();
+    auto results = batchRecognizer.RecogniteBatch(frames);
+    auto end = steady_clock::now();
+
+    size_t mismatchCount = 0;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        bool same = expected[i].size() == results[i].size();
+        for (size_t p = 0; same && p < expected[i].size(); ++p) {
+            same = expected[i][p].ToString() == results[i][p].ToString();
+        }
+        if (!same)
+            ++mismatchCount;
+    }
+    cout << "recognite batch: " << sampleCount
+         << " frames, mismatch: " << mismatchCount << ", serial ms: "
+         << duration_cast<milliseconds>(middle - start).count()
+         << ", batch ms: " << duration_cast<milliseconds>(end - middle).count()
+         << endl;
+    assert(mismatchCount == 0);
+}
+
+// 各阶段耗时的 p50/p95/p99，需要定义 PLATE_STAGE_TIMING 编译
+void benchmark_StageTimings(size_t sampleCount = 1000) {
+    if (!StageTimingEnabled) {
+        cerr << "stage timing is compiled out, define PLATE_STAGE_TIMING"
+             << endl;
+        return;
+    }
+    sampleCount = std::min(sampleCount, test_set.size());
+    recognizer.ResetStageStatistics();
+    for (size_t i = 0; i < sampleCount; ++i) {
+        recognizer.Recognite(get<0>(get_test_data(i)));
+    }
+    const StageStatistics &statistics = recognizer.GetStageStatistics();
+    cout << statistics.ToJson() << endl;
+    statistics.SaveJson("stage_timings.json");
+}
+
 int main(int argc, char const *argv[]) {
     InitSvm();
     test_Recoginition();
+    // test_ConcurrentRecognition();
+    // test_ParallelCandidates();
+    // benchmark_CandidatePolicy();
+    // benchmark_PlateLayout();
+    // benchmark_SplitTransformInput();
+    // test_RecogniteBatch();
+    // benchmark_StageTimings();
     // singleImage_getPlateInfo();
     // view_Image(1);
     std::cin.get();
@@ -1,11 +1,13 @@
 #include "CharInfo.h"
 #include "PlateCategory_SVM.h"
+#include "PlateCharCascade_SVM.h"
 #include "PlateChar_SVM.h"
 using cv::Mat;
 using cv::Rect;
 using cv::Scalar;
 
 #include <iostream>
+#include <iterator>
 #include <numeric>
 using std::cout;
 using std::endl;
@@ -18,6 +20,11 @@ using std::string;
 using std::vector;
 
 #include <cassert>
+#include <chrono>
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
 
 using namespace Doit::CV::PlateRecogn;
 void test_charinfo() {
@@ -122,6 +129,257 @@ void test_Char_SVM() {
          << " = " << setprecision(6) << float(trueCount) / validationCount << endl;
 }
 
+// 原来每次构造 HOGDescriptor 的做法，作为对照
+vector<float> reference_ComputeHogDescriptors(const Mat &image,
+                                              cv::Size winSize) {
+    Mat matToHog;
+    cv::resize(image, matToHog, winSize);
+    HOGDescriptor hog = HOGDescriptor(winSize, cv::Size(16, 16), cv::Size(8, 8),
+                                      cv::Size(8, 8), 9);
+    vector<float> ret;
+    hog.compute(matToHog, ret, cv::Size(1, 1), cv::Size(0, 0));
+    return ret;
+}
+
+// 每个描述子的耗时 (ns) 和与 HOGDescriptor 的最大误差，字符和车牌窗口各一次
+void benchmark_HogExtractor(int repeat = 10) {
+    string charsPath = "../../bin/platecharsamples/chars";
+    vector<Mat> images;
+    for (auto &imageCategory : Directory::GetFiles(charsPath)) {
+        for (auto &imageFile : Directory::GetFiles(imageCategory)) {
+            Mat image = cv::imread(imageFile);
+            if (!image.empty())
+                images.push_back(image);
+        }
+    }
+    if (images.empty())
+        return;
+
+    for (cv::Size winSize : {PlateChar_SVM::HOGWinSize,
+                             PlateCategory_SVM::HOGWinSize}) {
+        HogExtractor extractor(winSize, cv::Size(16, 16), cv::Size(8, 8),
+                               cv::Size(8, 8), 9);
+        vector<float> descriptor(extractor.GetDescriptorSize());
+        float maxError = 0;
+        steady_clock::duration referenceTime{0}, extractorTime{0};
+        for (int n = 0; n < repeat; ++n) {
+            for (auto &image : images) {
+                auto start = steady_clock::now();
+                vector<float> expected =
+                    reference_ComputeHogDescriptors(image, winSize);
+                auto middle = steady_clock::now();
+                extractor.Compute(image, descriptor.data());
+                auto stop = steady_clock::now();
+                referenceTime += middle - start;
+                extractorTime += stop - middle;
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    maxError =
+                        std::max(maxError, std::abs(expected[i] - descriptor[i]));
+                }
+            }
+        }
+        size_t count = images.size() * repeat;
+        cout << "hog " << winSize.width << "x" << winSize.height << ": "
+             << count << " descriptors, max error: " << maxError
+             << ", HOGDescriptor ns: "
+             << duration_cast<nanoseconds>(referenceTime).count() / count
+             << ", HogExtractor ns: "
+             << duration_cast<nanoseconds>(extractorTime).count() / count
+             << endl;
+        // HogKernel 注释中给出的误差范围
+        assert(maxError < 1e-4);
+    }
+}
+
+// 批量预测和逐个 SVM::predict 比较类别与耗时，每批 batchSize 个字符
+void benchmark_BatchPredict(int batchSize = 8) {
+    PlateChar_SVM classifier;
+    classifier.Load("CharSVM.yaml");
+    Ptr<SVM> reference = SVM::load("CharSVM.yaml");
+
+    string charsPath = "../../bin/platecharsamples/chars";
+    vector<Mat> images;
+    for (auto &imageCategory : Directory::GetFiles(charsPath)) {
+        for (auto &imageFile : Directory::GetFiles(imageCategory)) {
+            Mat image = cv::imread(imageFile);
+            if (!image.empty())
+                images.push_back(image);
+        }
+    }
+
+    size_t mismatchCount = 0;
+    steady_clock::duration singleTime{0}, batchTime{0};
+    vector<PlateChar_t> results;
+    for (size_t begin = 0; begin < images.size(); begin += batchSize) {
+        size_t end = std::min(images.size(), begin + batchSize);
+        vector<Mat> batch(images.begin() + begin, images.begin() + end);
+
+        vector<PlateChar_t> expected;
+        auto start = steady_clock::now();
+        for (auto &image : batch) {
+            vector<float> descriptor =
+                PlateChar_SVM::ComputeHogDescriptors(image);
+            Mat sample(1, (int)descriptor.size(), CV_32FC1, descriptor.data());
+            expected.push_back((PlateChar_t)(int)reference->predict(sample));
+        }
+        auto middle = steady_clock::now();
+        classifier.Test(batch, results);
+        auto stop = steady_clock::now();
+        singleTime += middle - start;
+        batchTime += stop - middle;
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (results[i] != expected[i] ||
+                classifier.Test(batch[i]) != expected[i])
+                ++mismatchCount;
+        }
+    }
+    cout << "batch predict: " << images.size() << " chars, batch size "
+         << batchSize << ", mismatch: " << mismatchCount << ", single us: "
+         << duration_cast<microseconds>(singleTime).count() << ", batch us: "
+         << duration_cast<microseconds>(batchTime).count() << endl;
+    assert(mismatchCount == 0);
+}
+
+// 车牌类别模型展开成权重矩阵后与 SVM::predict 比较类别和每次预测的耗时
+void benchmark_LinearCategory(int repeat = 10) {
+    Ptr<SVM> reference = SVM::load("CategorySVM.yaml");
+    SVMPredictor predictor;
+    predictor.Compile(reference);
+
+    string imagesPath = "../../bin/platecharsamples/plates";
+    vector<Mat> samples;
+    for (auto &imageCategory : Directory::GetFiles(imagesPath)) {
+        for (auto &imageFile : Directory::GetFiles(imageCategory)) {
+            Mat image = cv::imread(imageFile);
+            if (image.empty())
+                continue;
+            Mat sample(1, PlateCategory_SVM::GetHogDescriptorSize(), CV_32FC1);
+            PlateCategory_SVM::ComputeHogDescriptors(image,
+                                                     sample.ptr<float>(0));
+            samples.push_back(sample);
+        }
+    }
+    if (samples.empty() || !predictor.IsCompiled())
+        return;
+
+    size_t mismatchCount = 0;
+    steady_clock::duration referenceTime{0}, linearTime{0};
+    vector<int> labels;
+    for (int n = 0; n < repeat; ++n) {
+        for (auto &sample : samples) {
+            auto start = steady_clock::now();
+            int expected = (int)reference->predict(sample);
+            auto middle = steady_clock::now();
+            predictor.Predict(sample, labels);
+            auto stop = steady_clock::now();
+            referenceTime += middle - start;
+            linearTime += stop - middle;
+            if (labels[0] != expected)
+                ++mismatchCount;
+        }
+    }
+    size_t count = samples.size() * repeat;
+    cout << "linear category: " << samples.size() << " plates, linear: "
+         << predictor.IsLinear() << ", mismatch: " << mismatchCount
+         << ", SVM::predict ns: "
+         << duration_cast<nanoseconds>(referenceTime).count() / count
+         << ", weight matrix ns: "
+         << duration_cast<nanoseconds>(linearTime).count() / count << endl;
+    assert(mismatchCount == 0);
+}
+
+// 按类别目录读取字符样本，每 10 个取 1 个作为验证集，其余是训练集；
+// trainingImages 为空时只读验证集
+void load_char_samples(vector<Mat> &validationImages,
+                       vector<int> &validationTags,
+                       vector<Mat> *trainingImages = nullptr,
+                       vector<int> *trainingTags = nullptr) {
+    string charsPath = "../../bin/platecharsamples/chars";
+    size_t sampleIndex = 0;
+    for (auto &imageCategory : Directory::GetFiles(charsPath)) {
+        string tagStr = imageCategory.substr(charsPath.size() + 1);
+        auto tagIter =
+            find(begin(PlateChar_tToString), end(PlateChar_tToString), tagStr);
+        if (tagIter == end(PlateChar_tToString))
+            continue;
+        int tag = tagIter - begin(PlateChar_tToString);
+        for (auto &imageFile : Directory::GetFiles(imageCategory)) {
+            bool validation = sampleIndex++ % 10 == 0;
+            if (!validation && trainingImages == nullptr)
+                continue;
+            Mat image = cv::imread(imageFile);
+            if (image.empty())
+                continue;
+            if (validation) {
+                validationImages.push_back(image);
+                validationTags.push_back(tag);
+            } else {
+                trainingImages->push_back(image);
+                trainingTags->push_back(tag);
+            }
+        }
+    }
+}
+
+// 字符模型的 Nyström 近似与精确模型比较准确率和耗时。
+// 每 10 个样本取 1 个作为验证集，每批 batchSize 个字符
+void benchmark_NystromChar(int batchSize = 8) {
+    vector<Mat> images;
+    vector<int> tags;
+    load_char_samples(images, tags);
+
+    auto evaluate = [&](const PlateChar_SVM &classifier,
+                        vector<PlateChar_t> &predictions) {
+        predictions.clear();
+        vector<PlateChar_t> results;
+        auto start = steady_clock::now();
+        for (size_t begin = 0; begin < images.size(); begin += batchSize) {
+            size_t end = std::min(images.size(), begin + batchSize);
+            vector<Mat> batch(images.begin() + begin, images.begin() + end);
+            classifier.Test(batch, results);
+            predictions.insert(predictions.end(), results.begin(),
+                               results.end());
+        }
+        return steady_clock::now() - start;
+    };
+    auto accuracy = [&](const vector<PlateChar_t> &predictions) {
+        size_t trueCount = 0;
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            if ((int)predictions[i] == tags[i])
+                ++trueCount;
+        }
+        return float(trueCount) / predictions.size();
+    };
+
+    PlateChar_SVM exact;
+    exact.Load("CharSVM.yaml");
+    vector<PlateChar_t> expected;
+    auto exactTime = evaluate(exact, expected);
+    cout << "exact: " << images.size()
+         << " chars, accuracy: " << accuracy(expected) << ", us: "
+         << duration_cast<microseconds>(exactTime).count() << endl;
+
+    for (int landmarkCount : {64, 128, 256, 512}) {
+        PlateChar_SVM approximate;
+        approximate.Load("CharSVM.yaml", landmarkCount);
+        vector<PlateChar_t> predictions;
+        auto approximateTime = evaluate(approximate, predictions);
+        size_t agreeCount = 0;
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            if (predictions[i] == expected[i])
+                ++agreeCount;
+        }
+        cout << "nystrom " << landmarkCount
+             << " landmarks, accuracy: " << accuracy(predictions)
+             << ", agree with exact: " << agreeCount << " / "
+             << predictions.size() << ", us: "
+             << duration_cast<microseconds>(approximateTime).count()
+             << ", speedup: "
+             << (double)exactTime.count() / approximateTime.count() << endl;
+    }
+}
+
 void test_Category_SVM() {
     PlateCategory_SVM classifier;
 
@@ -334,11 +592,192 @@ void grid_search() {
          << ", best_accuracy: " << best_accuracy << endl;
 }
 
+// 字符模型的支持向量量化成 int8 / fp16 后与 float 模型比较准确率、耗时和
+// 支持向量占用的内存。每 10 个样本取 1 个作为验证集，每批 batchSize 个字符
+void benchmark_QuantizedChar(int batchSize = 8) {
+    vector<Mat> images;
+    vector<int> tags;
+    load_char_samples(images, tags);
+
+    // 先算好 HOG，只比较预测本身
+    Mat samples((int)images.size(), PlateChar_SVM::GetHogDescriptorSize(),
+                CV_32FC1);
+    for (size_t i = 0; i < images.size(); ++i) {
+        PlateChar_SVM::ComputeHogDescriptors(images[i],
+                                             samples.ptr<float>((int)i));
+    }
+    Ptr<SVM> svm = SVM::load("CharSVM.yaml");
+    auto evaluate = [&](const SVMPredictor &predictor, vector<int> &labels) {
+        labels.clear();
+        vector<int> results;
+        auto start = steady_clock::now();
+        for (int begin = 0; begin < samples.rows; begin += batchSize) {
+            int end = std::min(samples.rows, begin + batchSize);
+            predictor.Predict(samples.rowRange(begin, end), results);
+            labels.insert(labels.end(), results.begin(), results.end());
+        }
+        return steady_clock::now() - start;
+    };
+
+    SVMPredictor exact;
+    if (!exact.Compile(svm))
+        return;
+    vector<int> expected;
+    auto exactTime = evaluate(exact, expected);
+    const char *names[] = {"float", "int8", "fp16"};
+    for (auto storage : {SVMPredictor::VectorStorage::Float32,
+                         SVMPredictor::VectorStorage::Int8,
+                         SVMPredictor::VectorStorage::Float16}) {
+        SVMPredictor predictor;
+        predictor.Compile(svm);
+        if (!predictor.Quantize(storage))
+            continue;
+        vector<int> labels;
+        auto time = evaluate(predictor, labels);
+        size_t trueCount = 0, agreeCount = 0;
+        for (size_t i = 0; i < labels.size(); ++i) {
+            if (labels[i] == tags[i])
+                ++trueCount;
+            if (labels[i] == expected[i])
+                ++agreeCount;
+        }
+        cout << names[(int)storage] << ": " << labels.size()
+             << " chars, accuracy: " << float(trueCount) / labels.size()
+             << ", agree with float: " << agreeCount << " / " << labels.size()
+             << ", vector bytes: " << predictor.GetVectorBytes()
+             << ", us: " << duration_cast<microseconds>(time).count()
+             << ", speedup: " << (double)exactTime.count() / time.count()
+             << endl;
+    }
+}
+
+// 两级字符分类与单个 SVM 比较准确率、每个字符的决策函数个数和耗时。
+// 每 10 个样本取 1 个作为验证集，其余训练级联模型
+void test_CharCascade() {
+    vector<Mat> validationImages, trainingImages;
+    vector<int> validationTags, trainingTags;
+    load_char_samples(validationImages, validationTags, &trainingImages,
+                      &trainingTags);
+    if (validationImages.empty() || trainingImages.empty())
+        return;
+
+    int hogSize = PlateChar_SVM::GetHogDescriptorSize();
+    Mat trainingData((int)trainingImages.size(), hogSize, CV_32FC1);
+    Mat trainingTag(trainingTags, true);
+    for (size_t i = 0; i < trainingImages.size(); ++i) {
+        PlateChar_SVM::ComputeHogDescriptors(trainingImages[i],
+                                             trainingData.ptr<float>((int)i));
+    }
+    Mat validationData((int)validationImages.size(), hogSize, CV_32FC1);
+    for (size_t i = 0; i < validationImages.size(); ++i) {
+        PlateChar_SVM::ComputeHogDescriptors(validationImages[i],
+                                             validationData.ptr<float>((int)i));
+    }
+
+    PlateCharCascade_SVM cascade;
+    if (!Directory::Exists("CharCascadeSVM.yaml")) {
+        cout << "Traininig cascade ..." << endl;
+        cascade.Train(trainingData, trainingTag);
+        cascade.Save("CharCascadeSVM.yaml");
+    } else {
+        cout << "Loading trained cascade ..." << endl;
+        cascade.Load("CharCascadeSVM.yaml");
+    }
+
+    auto report = [&](const char *name, const vector<int> &predictions,
+                      steady_clock::duration time) {
+        size_t trueCount = 0;
+        for (size_t i = 0; i < predictions.size(); ++i) {
+            if (predictions[i] == validationTags[i])
+                ++trueCount;
+        }
+        cout << name << ": accuracy " << trueCount << " / "
+             << predictions.size() << " = "
+             << float(trueCount) / predictions.size() << ", ns per char: "
+             << duration_cast<nanoseconds>(time).count() / predictions.size()
+             << endl;
+    };
+
+    vector<PlateChar_t> results;
+    auto start = steady_clock::now();
+    cascade.Predict(validationData, {}, results);
+    auto cascadeTime = steady_clock::now() - start;
+    vector<int> predictions(results.begin(), results.end());
+    cout << "cascade functions per char: " << cascade.GetGroupFunctionCount()
+         << " + at most " << cascade.GetMaxStageFunctionCount() << endl;
+    report("cascade", predictions, cascadeTime);
+
+    if (!Directory::Exists("CharSVM.yaml"))
+        return;
+    SVMPredictor single;
+    single.Compile(SVM::load("CharSVM.yaml"));
+    start = steady_clock::now();
+    single.Predict(validationData, predictions);
+    auto singleTime = steady_clock::now() - start;
+    int classCount = single.GetClassCount();
+    cout << "single functions per char: " << classCount * (classCount - 1) / 2
+         << endl;
+    report("single", predictions, singleTime);
+}
+
+// 每种核函数的 SVMPredictor 与 svm->predict 的结果必须相同
+void test_PredictorKernels(int classCount = 5, int samplesPerClass = 40,
+                           int dims = 16) {
+    cv::RNG rng(12345);
+    Mat samples(classCount * samplesPerClass, dims, CV_32FC1);
+    Mat responses(samples.rows, 1, CV_32SC1);
+    for (int row = 0; row < samples.rows; row++) {
+        int label = row / samplesPerClass;
+        Mat sample = samples.row(row);
+        rng.fill(sample, cv::RNG::NORMAL, label * 0.5, 1.0);
+        responses.at<int>(row) = label;
+    }
+
+    const SVM::KernelTypes kernels[] = {SVM::LINEAR, SVM::POLY, SVM::RBF,
+                                        SVM::SIGMOID};
+    const char *names[] = {"linear", "poly", "rbf", "sigmoid"};
+    for (size_t k = 0; k < std::size(kernels); k++) {
+        Ptr<SVM> svm = SVM::create();
+        svm->setType(SVM::C_SVC);
+        svm->setKernel(kernels[k]);
+        svm->setC(1);
+        svm->setGamma(0.05);
+        svm->setCoef0(kernels[k] == SVM::SIGMOID ? -0.5 : 1);
+        svm->setDegree(2);
+        svm->train(samples, cv::ml::ROW_SAMPLE, responses);
+
+        SVMPredictor predictor;
+        if (!predictor.Compile(svm)) {
+            cout << names[k] << ": not compiled" << endl;
+            continue;
+        }
+        vector<int> labels;
+        predictor.Predict(samples, labels);
+        Mat expected;
+        svm->predict(samples, expected);
+        size_t mismatchCount = 0;
+        for (int row = 0; row < samples.rows; row++) {
+            if (labels[row] != (int)expected.at<float>(row))
+                ++mismatchCount;
+        }
+        cout << names[k] << ": " << samples.rows
+             << " samples, mismatch: " << mismatchCount << endl;
+        assert(mismatchCount == 0);
+    }
+}
+
 int main(int argc, char const *argv[]) {
     // test_charinfo();
     // test_plateinfo();
     test_Char_SVM();
     //test_Category_SVM();
+    // benchmark_HogExtractor();
+    // benchmark_BatchPredict();
+    // benchmark_LinearCategory();
+    // benchmark_NystromChar();
+    // benchmark_QuantizedChar();
+    // test_CharCascade();
+    // test_PredictorKernels();
 
     // grid_search();
     std::cin.get();
@@ -581,10 +581,10 @@ void TrainWorker::train(MainWindow *mainWindow) {
     }
 
     if(mainWindow->mode == MainWindow::PLATE_CHAR)
-        PlateChar_SVM::Train(training_data, training_tag, mainWindow->kernel,
+        mainWindow->charSVM.Train(training_data, training_tag, mainWindow->kernel,
                      mainWindow->C, mainWindow->gamma, mainWindow->degree);
     else
-        PlateCategory_SVM::Train(training_data, training_tag, mainWindow->kernel,
+        mainWindow->categorySVM.Train(training_data, training_tag, mainWindow->kernel,
                      mainWindow->C, mainWindow->gamma, mainWindow->degree);
                     
     vector<int> validationPrediction = {};
@@ -595,9 +595,9 @@ void TrainWorker::train(MainWindow *mainWindow) {
         Mat image = mainWindow->images[mainWindow->validationIndices[i]];
         int prediction;
         if(mainWindow->mode == MainWindow::PLATE_CHAR)
-            prediction = static_cast<int>(PlateChar_SVM::Test(image));
+            prediction = static_cast<int>(mainWindow->charSVM.Test(image));
         else
-            prediction = static_cast<int>(PlateCategory_SVM::Test(image));
+            prediction = static_cast<int>(mainWindow->categorySVM.Test(image));
 
         validationPrediction.push_back(prediction);
         if (prediction ==
@@ -623,9 +623,9 @@ void TrainWorker::train(MainWindow *mainWindow) {
     mainWindow->ui->timeCounter_label->setText(QString::number(mss));
 
     if(mainWindow->mode == MainWindow::PLATE_CHAR)
-        PlateChar_SVM::Save(MainWindow::CharModelFileName.toStdString());
+        mainWindow->charSVM.Save(MainWindow::CharModelFileName.toStdString());
     else
-        PlateCategory_SVM::Save(MainWindow::CategoryModelFileName.toStdString());
+        mainWindow->categorySVM.Save(MainWindow::CategoryModelFileName.toStdString());
     mainWindow->validationPrediction = validationPrediction;
     emit prediction_Completed();
 }
@@ -12,6 +12,9 @@ using cv::Mat;
 #include <opencv2/ml.hpp>
 using cv::ml::SVM;
 
+#include "PlateCategory_SVM.h"
+#include "PlateChar_SVM.h"
+
 /*--------  Forward declarations  --------*/
 namespace Doit {
 namespace CV {
@@ -93,6 +96,8 @@ private:
     double gamma = 1;
     SVM::KernelTypes kernel = SVM::KernelTypes::RBF;
     float degree = 1;
+    Doit::CV::PlateRecogn::PlateChar_SVM charSVM;
+    Doit::CV::PlateRecogn::PlateCategory_SVM categorySVM;
 
     std::vector<SVM::KernelTypes> candidateKernels = {
         SVM::KernelTypes::LINEAR, SVM::KernelTypes::RBF,
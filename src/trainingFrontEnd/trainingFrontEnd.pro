@@ -25,21 +25,33 @@ DEFINES -= UNICODE
 
 CONFIG += c++17 debug
 
+# HogKernel / QuantizedKernel 的 SSE4.1 实现，MSVC x64 不需要参数
+!msvc:contains(QT_ARCH, x86_64|i386): QMAKE_CXXFLAGS += -msse4.1
+
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
 # for classifier
         ../classifier/CharInfo.cpp \
+        ../classifier/HogExtractor.cpp \
+        ../classifier/MappedFile.cpp \
         ../classifier/PlateChar_SVM.cpp \
         ../classifier/PlateCategory_SVM.cpp \
+        ../classifier/SVMPredictor.cpp \
         ../classifier/Utilities.cpp
 
 HEADERS += \
         mainwindow.h \
 # for classifier
         ../classifier/CharInfo.h \
+        ../classifier/HogExtractor.h \
+        ../classifier/HogKernel.h \
+        ../classifier/MappedFile.h \
+        ../classifier/QuantizedKernel.h \
         ../classifier/PlateChar_SVM.h \
         ../classifier/PlateCategory_SVM.h \
+        ../classifier/SVMPredictor.h \
+        ../classifier/StageTimer.h \
         ../classifier/Utilities.h
 
 FORMS += \